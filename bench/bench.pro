@@ -0,0 +1,15 @@
+# Benchmarks: qmake CONFIG+=release && make, then run each program.
+# The measured figures are in README.md.
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    lineframer \
+    tpgparser \
+    textrecord \
+    compressedlog \
+    textrunparser \
+    pipeline \
+    pixeltransform \
+    m4paint \
+    logaxis \
+    symbols
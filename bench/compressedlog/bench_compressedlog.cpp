@@ -0,0 +1,174 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+
+// Size and decoding speed of the compressed logs, for one day of
+// COM,0 samples (100 ms) of a pump-down and of a flat run. The sizes
+// include the file header and the chunk headers; the text size is
+// the one of the same samples written by TextRecordEncoder. The
+// whole file is decoded chunk by chunk with CompressedLogReader.
+
+#include "compressedlog.h"
+#include "pressuresample.h"
+#include "textrecord.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+
+static const int nSamples = 864000;
+
+
+struct Samples {
+    QVector<double> times;
+    QVector<double> pressures;
+    QVector<quint8> statuses;
+};
+
+
+// The time of each LF arrival jitters by up to 2 ms around the 100 ms
+// period; the pressures have the 5 digits sent by the gauge
+static double
+arrivalTime(int i) {
+    return i*0.1 + ((qint64(i)*7919)%4001 - 2000)*1.0e-6;
+}
+
+
+static double
+gaugeReading(double pressure) {
+    char sReading[32];
+    std::snprintf(sReading, sizeof(sReading), "%.4E", pressure);
+    return std::strtod(sReading, nullptr);
+}
+
+
+// From the atmosphere to 1e-7 mbar, then in the noise of the gauge
+static Samples
+pumpDown() {
+    Samples samples;
+    for(int i=0; i<nSamples; i++) {
+        const double t = i*0.1;
+        double pressure = 1013.25*std::exp(-t/30.0) + 2.0e-3*std::exp(-t/3000.0) + 1.0e-7;
+        pressure *= 1.0 + ((i*2654435761u) >> 22)*1.0e-6;
+        samples.times.append(arrivalTime(i));
+        samples.pressures.append(gaugeReading(pressure));
+        samples.statuses.append(PressureSample::MeasurementOk);
+    }
+    return samples;
+}
+
+
+// A gauge that keeps sending the same reading
+static Samples
+flatRun() {
+    Samples samples;
+    for(int i=0; i<nSamples; i++) {
+        samples.times.append(arrivalTime(i));
+        samples.pressures.append(gaugeReading(5.0e-4));
+        samples.statuses.append(PressureSample::MeasurementOk);
+    }
+    return samples;
+}
+
+
+static qint64
+textBytes(const Samples& samples) {
+    TextRecordEncoder encoder;
+    qint64 nBytes = TextRecordEncoder::header(QStringList()).size();
+    for(int i=0; i<samples.times.count(); i++) {
+        encoder.append(samples.times.at(i), samples.pressures.at(i));
+        if(encoder.size() > (1 << 20)) {
+            nBytes += encoder.size();
+            encoder.clear();
+        }
+    }
+    return nBytes + encoder.size();
+}
+
+
+static void
+run(const char* sName, const Samples& samples) {
+    QTemporaryFile file;
+    if(!file.open()) {
+        std::printf("Error: no temporary file\n");
+        std::exit(1);
+    }
+    CompressedLogEncoder encoder;
+    QElapsedTimer timer;
+    timer.start();
+    file.write(CompressedLogEncoder::header(QString(), 0));
+    for(int i=0; i<samples.times.count(); i++) {
+        encoder.append(samples.times.at(i), samples.pressures.at(i), samples.statuses.at(i));
+        if(encoder.isChunkFull())
+            file.write(encoder.finishChunk());
+    }
+    if(encoder.pendingSamples() > 0)
+        file.write(encoder.finishChunk());
+    const double encodeSeconds = timer.nsecsElapsed()*1.0e-9;
+    file.close();
+
+    CompressedLogReader reader;
+    if(!reader.open(file.fileName())) {
+        std::printf("Error: %s\n", qPrintable(reader.errorString()));
+        std::exit(1);
+    }
+    const qint64 fileSize = QFileInfo(file.fileName()).size();
+    QVector<double> times, pressures;
+    QVector<quint8> statuses;
+    qint64 nDecoded = 0;
+    timer.start();
+    for(int i=0; i<reader.chunkCount(); i++) {
+        times.resize(0);
+        pressures.resize(0);
+        statuses.resize(0);
+        if(!reader.decodeChunk(i, times, pressures, statuses)) {
+            std::printf("Error decoding chunk %d\n", i);
+            std::exit(1);
+        }
+        nDecoded += times.count();
+    }
+    const double decodeSeconds = timer.nsecsElapsed()*1.0e-9;
+    if(nDecoded != samples.times.count())
+        std::printf("Error: %lld samples decoded instead of %d\n", nDecoded, samples.times.count());
+
+    const qint64 textSize = textBytes(samples);
+    std::printf("%-10s %12.2f %12.2f %10.1f %12.1f %12.0f %12.1f\n", sName,
+                double(fileSize)/nDecoded, double(textSize)/nDecoded,
+                double(textSize)/fileSize,
+                nDecoded/encodeSeconds/1.0e6,
+                fileSize/decodeSeconds/1.0e6, nDecoded/decodeSeconds/1.0e6);
+}
+
+
+int
+main() {
+    std::printf("%-10s %12s %12s %10s %12s %12s %12s\n", "run", "bytes/sample",
+                "text", "ratio", "encode M/s", "decode MB/s", "decode M/s");
+    run("pump-down", pumpDown());
+    run("flat", flatRun());
+    return 0;
+}
@@ -0,0 +1,13 @@
+QT -= gui
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = bench_compressedlog
+INCLUDEPATH += ../..
+
+SOURCES += \
+    bench_compressedlog.cpp \
+    ../../binarylog.cpp \
+    ../../compressedlog.cpp \
+    ../../textrecord.cpp
@@ -0,0 +1,81 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+// LineFramer throughput on a synthetic TPG 261 stream.
+// The stream is handed to the framer in bursts of a fixed size, as
+// readyRead() would, and every burst is drained with takeLines().
+// A 38400 baud line (8N1) carries 3840 bytes/s, i.e. 256 records/s
+// of "s,+x.xxxxE-yy\r\n": the headroom is printed for each burst size.
+
+#include "lineframer.h"
+
+#include <QElapsedTimer>
+#include <cstdio>
+#include <cstring>
+
+
+static const double lineRate38400 = 3840.0/15.0;
+
+
+int
+main() {
+    // 15 bytes records, as sent in continuous mode
+    const int nRecords = 2000000;
+    QByteArray stream;
+    stream.reserve(nRecords*15);
+    char record[32];
+    for(int i=0; i<nRecords; i++) {
+        std::snprintf(record, sizeof(record), "%d,+%d.%04dE-%02d\r\n",
+                      i%3, 1+i%9, i%10000, i%10);
+        stream.append(record, 15);
+    }
+
+    const int burstSizes[] = {1, 8, 32, 256, 4096};
+    std::printf("%10s %14s %14s\n", "burst [B]", "lines/s", "x 38400 baud");
+    for(int burst : burstSizes) {
+        LineFramer framer;
+        QVector<QByteArray> lines;
+        QVector<int> bytesAfter;
+        lines.reserve(4096);
+        bytesAfter.reserve(4096);
+        qint64 nLines = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for(int done=0; done<stream.size(); ) {
+            int nContiguous;
+            char* p = framer.writePointer(nContiguous);
+            const int n = qMin(qMin(nContiguous, burst), stream.size()-done);
+            std::memcpy(p, stream.constData()+done, size_t(n));
+            framer.commit(n);
+            done += n;
+            nLines += framer.takeLines(lines, bytesAfter);
+            lines.resize(0);
+            bytesAfter.resize(0);
+        }
+        const double seconds = timer.nsecsElapsed()*1.0e-9;
+        if(nLines != nRecords)
+            std::printf("Error: %lld lines framed instead of %d\n", nLines, nRecords);
+        std::printf("%10d %14.0f %14.0f\n", burst, nLines/seconds, nLines/seconds/lineRate38400);
+    }
+    return 0;
+}
@@ -0,0 +1,11 @@
+QT -= gui
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = bench_lineframer
+INCLUDEPATH += ../..
+
+SOURCES += \
+    bench_lineframer.cpp \
+    ../../lineframer.cpp
@@ -0,0 +1,145 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+
+// LinePlot frame time on a log y axis, with the log10 taken for every
+// point at every frame (as before they were stored with the points)
+// and with the logY column of the DataStream2D chunks. Both frames map
+// the same window, reduce it with reduceM4() and draw one polyline on a
+// 800 x 600 image. The log10 column is paid once, when the points are
+// added: the cost per point of AddPoints() is printed too.
+
+#include "datastream2d.h"
+#include "pixeltransform.h"
+
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+
+
+static const int nFrames = 10;
+
+
+// The mapping of the frame before the log10 column
+static void
+mapLog10(const AxisTransform& t, const double* pValues, int n, int* pPixels) {
+    for(int i=0; i<n; i++) {
+        const double v = pValues[i];
+        pPixels[i] = v > 0.0 ? int(t.origin + (log10(v) - t.vMin)*t.factor) : -INT_MAX;
+    }
+}
+
+
+// Maps the window span by span, as Plot2D::TransformPoints() does
+static void
+mapWindow(const DataSnapshot& window, const AxisTransform& tx, const AxisTransform& ty,
+          bool bCached, QVector<int>& pixelX, QVector<int>& pixelY, QVector<quint8>& mask) {
+    const int n = window.count();
+    pixelX.resize(n);
+    pixelY.resize(n);
+    mask.resize(n);
+    const DataChunk* pChunk;
+    int slot;
+    for(int i=0; i<n; ) {
+        const int nSpan = window.span(i, n, pChunk, slot);
+        transformAxis(tx, pChunk->x+slot, pChunk->logX+slot, nSpan,
+                      pixelX.data()+i, mask.data()+i, false);
+        if(bCached)
+            transformAxis(ty, pChunk->y+slot, pChunk->logY+slot, nSpan,
+                          pixelY.data()+i, mask.data()+i, true);
+        else
+            mapLog10(ty, pChunk->y+slot, nSpan, pixelY.data()+i);
+        i += nSpan;
+    }
+}
+
+
+int
+main(int argc, char *argv[]) {
+    QGuiApplication application(argc, argv);
+    QImage image(800, 600, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    painter.setPen(QPen(Qt::yellow, 1));
+    QVector<int> pixelX, pixelY;
+    QVector<quint8> mask;
+    QVector<QPoint> path;
+
+    std::printf("%10s %16s %16s %16s\n",
+                "points", "AddPoints [ns]", "log10 frame", "logY frame");
+    for(int n=100000; n<=10000000; n*=10) {
+        // One sample per second, the pressure a log random walk
+        // between 1e-9 and 1e+3 mbar
+        QVector<double> x(n), y(n);
+        quint32 seed = 261;
+        double walk = -3.0;
+        for(int i=0; i<n; i++) {
+            seed = seed*1664525u + 1013904223u;
+            walk += (double(seed)/4294967296.0 - 0.5)*0.02;
+            walk  = qBound(-9.0, walk, 3.0);
+            x[i] = i;
+            y[i] = pow(10.0, walk);
+        }
+        DataStream2D data(1, 1, Qt::yellow, 0, "Pressure");
+        data.setMaxPoints(n);
+        QElapsedTimer timer;
+        timer.start();
+        data.AddPoints(x.constData(), y.constData(), n);
+        const qint64 nsAdd = timer.nsecsElapsed();
+        std::shared_ptr<const DataSnapshot> window = data.snapshot();
+
+        AxisTransform tx;
+        tx.lo     = 0.0;
+        tx.hi     = n;
+        tx.vMin   = tx.lo;
+        tx.factor = 760.0/(tx.hi-tx.lo);
+        tx.origin = 20.0;
+        tx.bLog   = false;
+        AxisTransform ty;
+        ty.lo     = 1.0e-9;
+        ty.hi     = 1.0e+3;
+        ty.vMin   = log10(ty.lo);
+        ty.factor = -560.0/(log10(ty.hi)-ty.vMin);
+        ty.origin = 580.0;
+        ty.bLog   = true;
+
+        qint64 nsFrame[2] = {0, 0};
+        for(int cached=0; cached<2; cached++) {
+            for(int frame=0; frame<nFrames; frame++) {
+                image.fill(Qt::black);
+                timer.restart();
+                mapWindow(*window, tx, ty, cached != 0, pixelX, pixelY, mask);
+                reduceM4(pixelX.constData(), pixelY.constData(), n, 780, path);
+                painter.drawPolyline(path.constData(), path.count());
+                nsFrame[cached] += timer.nsecsElapsed();
+            }
+        }
+        std::printf("%10d %16.1f %13.2f ms %13.2f ms\n", n, double(nsAdd)/n,
+                    nsFrame[0]*1.0e-6/nFrames, nsFrame[1]*1.0e-6/nFrames);
+    }
+    painter.end();
+    return 0;
+}
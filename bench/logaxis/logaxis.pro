@@ -0,0 +1,15 @@
+# QPainter on a QImage: no window is opened
+QT += gui
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = bench_logaxis
+INCLUDEPATH += ../..
+
+SOURCES += \
+    bench_logaxis.cpp \
+    ../../DataSetProperties.cpp \
+    ../../datastream2d.cpp \
+    ../../pixeltransform.cpp \
+    ../../samplestore.cpp
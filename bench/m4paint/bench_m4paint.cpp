@@ -0,0 +1,96 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+
+// LinePlot paint time against the number of points in the x range,
+// from 10^3 to 10^7, on a 800 x 600 image. The points are a random
+// walk spread over the 760 pixel columns of the frame. The first column
+// draws one segment per point, as LinePlot did before the M4 reduction;
+// the others reduce the path with reduceM4() and draw it as one polyline.
+
+#include "pixeltransform.h"
+
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <cstdio>
+
+
+static const int frameLeft   = 20;
+static const int frameWidth  = 760;
+static const int frameTop    = 20;
+static const int frameHeight = 560;
+
+
+static void
+makePixels(int n, QVector<int>& x, QVector<int>& y) {
+    x.resize(n);
+    y.resize(n);
+    quint32 seed = 261;
+    double walk = 0.5*frameHeight;
+    for(int i=0; i<n; i++) {
+        seed = seed*1664525u + 1013904223u;
+        walk += (double(seed)/4294967296.0 - 0.5)*8.0;
+        walk  = qBound(0.0, walk, double(frameHeight-1));
+        x[i] = frameLeft + int(double(i)*frameWidth/n);
+        y[i] = frameTop + int(walk);
+    }
+}
+
+
+int
+main(int argc, char *argv[]) {
+    QGuiApplication application(argc, argv);
+    QImage image(800, 600, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    painter.setPen(QPen(Qt::yellow, 1));
+    QVector<int> x, y;
+    QVector<QPoint> path;
+
+    std::printf("%10s %14s %14s %14s %10s\n",
+                "points", "per segment", "reduceM4", "drawPolyline", "M4 points");
+    for(int n=1000; n<=10000000; n*=10) {
+        makePixels(n, x, y);
+        QElapsedTimer timer;
+
+        image.fill(Qt::black);
+        timer.start();
+        for(int i=1; i<n; i++)
+            painter.drawLine(QLine(x.at(i-1), y.at(i-1), x.at(i), y.at(i)));
+        const qint64 nsSegments = timer.nsecsElapsed();
+
+        image.fill(Qt::black);
+        timer.restart();
+        reduceM4(x.constData(), y.constData(), n, frameLeft+frameWidth, path);
+        const qint64 nsReduce = timer.nsecsElapsed();
+        timer.restart();
+        painter.drawPolyline(path.constData(), path.count());
+        const qint64 nsPolyline = timer.nsecsElapsed();
+
+        std::printf("%10d %11.3f ms %11.3f ms %11.3f ms %10d\n",
+                    n, nsSegments*1.0e-6, nsReduce*1.0e-6, nsPolyline*1.0e-6, path.count());
+    }
+    painter.end();
+    return 0;
+}
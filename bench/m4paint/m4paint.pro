@@ -0,0 +1,12 @@
+# QPainter on a QImage: no window is opened
+QT += gui
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = bench_m4paint
+INCLUDEPATH += ../..
+
+SOURCES += \
+    bench_m4paint.cpp \
+    ../../pixeltransform.cpp
@@ -0,0 +1,209 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+
+// Acquisition throughput from the serial stream to the plot and the file.
+// A synthetic COM,0 stream is handed in 32 bytes bursts to LineFramer in
+// a second thread, parsed and pushed on the SpscRing of tgp261, as
+// CommunicationModule and tgp261::onNewLines() do. The main thread
+// drains the ring as MainWindow::onSamplesAvailable() does: the samples
+// are encoded as text for the OutputWriter and added to a Plot2D, which
+// is published once per batch. The stream is sent first at the rate of
+// a 38400 baud line, then as fast as the framer can take it: the samples
+// the ring had no room for are counted as dropped.
+// The Plot2D is not shown (QT_QPA_PLATFORM=offscreen): the painting is
+// measured by the m4paint, logaxis and symbols programs.
+
+#include "lineframer.h"
+#include "outputwriter.h"
+#include "plot2d.h"
+#include "pressuresample.h"
+#include "spscring.h"
+#include "textrecord.h"
+#include "tpgparser.h"
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QtConcurrent>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+
+static const int    recordBytes   = 15;
+static const int    burstBytes    = 32;
+static const double lineRate38400 = 3840.0/recordBytes;
+
+
+struct Run {
+    qint64 nSent;
+    qint64 nStored;
+    qint64 nDropped;
+    double seconds;
+};
+
+
+static QByteArray
+tpgStream(int nRecords) {
+    QByteArray stream;
+    stream.reserve(nRecords*recordBytes);
+    char record[32];
+    for(int i=0; i<nRecords; i++) {
+        std::snprintf(record, sizeof(record), "%d,+%d.%04dE-%02d\r\n",
+                      i%3, 1+i%9, i%10000, i%10);
+        stream.append(record, recordBytes);
+    }
+    return stream;
+}
+
+
+// The acquisition thread. With bPaced the bursts leave no sooner
+// than a 38400 baud line would deliver them.
+static void
+acquire(const QByteArray& stream, bool bPaced,
+        SpscRing<PressureSample, 4096>& ring,
+        std::atomic<qint64>& nDropped, std::atomic<bool>& bDone) {
+    LineFramer framer;
+    QVector<QByteArray> lines;
+    QVector<int> bytesAfter;
+    lines.reserve(4096);
+    bytesAfter.reserve(4096);
+    const qint64 nsPerByte = 10000000000LL/38400;
+    const qint64 startNs   = monotonicNSecs();
+    PressureSample sample;
+    for(int done=0; done<stream.size(); ) {
+        if(bPaced) {
+            const qint64 dueNs = startNs + qint64(done+burstBytes)*nsPerByte;
+            const qint64 waitNs = dueNs - monotonicNSecs();
+            if(waitNs > 0)
+                QThread::usleep(static_cast<unsigned long>(waitNs/1000));
+        }
+        int nContiguous;
+        char* p = framer.writePointer(nContiguous);
+        const int n = qMin(qMin(nContiguous, burstBytes), stream.size()-done);
+        std::memcpy(p, stream.constData()+done, size_t(n));
+        framer.commit(n);
+        done += n;
+        lines.resize(0);
+        bytesAfter.resize(0);
+        framer.takeLines(lines, bytesAfter);
+        const qint64 readNs = monotonicNSecs();
+        for(int i=0; i<lines.count(); i++) {
+            sample.monotonicNs = readNs - bytesAfter.at(i)*nsPerByte;
+            if(!parseTpgMeasurement(lines.at(i).constData(), lines.at(i).size(),
+                                    sample.status, sample.pressure))
+                continue;
+            if(!ring.push(sample))
+                nDropped++;
+        }
+    }
+    bDone = true;
+}
+
+
+static Run
+runPipeline(const QByteArray& stream, bool bPaced, const QString& sFileName) {
+    SpscRing<PressureSample, 4096> ring;
+    std::atomic<qint64> nDropped(0);
+    std::atomic<bool>   bDone(false);
+
+    Plot2D plot(nullptr, "Pressure [mbar] vs Time [s]");
+    plot.SetLimits(0.0, 1.0, 0.1, 1.0, true, true, false, false);
+    plot.NewDataSet(1, 3, QColor(208, 208, 255), Plot2D::ipoint, "Saved");
+    plot.SetShowDataSet(1, true);
+    OutputWriter writer;
+    writer.open(sFileName, OutputWriter::Policy());
+    const QByteArray header = TextRecordEncoder::header(QStringList());
+    writer.append(header.constData(), header.size(), 0);
+    TextRecordEncoder encoder;
+
+    Run run;
+    run.nSent   = stream.size()/recordBytes;
+    run.nStored = 0;
+    QElapsedTimer timer;
+    timer.start();
+    const qint64 startNs = monotonicNSecs();
+    QFuture<void> acquisition = QtConcurrent::run([&]() {
+        acquire(stream, bPaced, ring, nDropped, bDone);
+    });
+    PressureSample sample;
+    for(;;) {
+        const bool bLast = bDone.load();
+        bool bNewSamples = false;
+        while(ring.pop(sample)) {
+            const double x = double(sample.monotonicNs-startNs)*1.0e-9;
+            encoder.append(x, sample.pressure);
+            plot.NewPoint(1, x, sample.pressure);
+            bNewSamples = true;
+        }
+        if(encoder.records() > 0) {
+            run.nStored += encoder.records();
+            writer.append(encoder.data(), encoder.size(), encoder.records());
+            encoder.clear();
+        }
+        if(bNewSamples) {
+            plot.PublishPoints();
+            plot.UpdatePlot();
+        }
+        QCoreApplication::processEvents();
+        if(bLast && !bNewSamples)
+            break;
+        if(!bNewSamples)
+            QThread::yieldCurrentThread();
+    }
+    acquisition.waitForFinished();
+    writer.close();
+    run.seconds  = timer.nsecsElapsed()*1.0e-9;
+    run.nDropped = nDropped.load();
+    return run;
+}
+
+
+static void
+report(const char* sName, const Run& run) {
+    const double samplesPerSecond = run.nStored/run.seconds;
+    std::printf("%-12s %10lld %10lld %10lld %12.0f %14.1f\n", sName,
+                run.nSent, run.nStored, run.nDropped,
+                samplesPerSecond, samplesPerSecond/lineRate38400);
+}
+
+
+int
+main(int argc, char *argv[]) {
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QTemporaryDir dir;
+    if(!dir.isValid()) {
+        std::printf("Error: no temporary directory\n");
+        return 1;
+    }
+    std::printf("%-12s %10s %10s %10s %12s %14s\n",
+                "stream", "sent", "stored", "dropped", "samples/s", "x 38400 baud");
+    // 10 s of samples at the line rate
+    report("38400 baud", runPipeline(tpgStream(2560), true, dir.filePath("paced.txt")));
+    report("unthrottled", runPipeline(tpgStream(2000000), false, dir.filePath("burst.txt")));
+    return 0;
+}
@@ -0,0 +1,31 @@
+# Plot2D needs a QApplication: the offscreen platform is used
+QT += widgets concurrent
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = bench_pipeline
+INCLUDEPATH += ../..
+
+SOURCES += \
+    bench_pipeline.cpp \
+    ../../AxisFrame.cpp \
+    ../../AxisLimits.cpp \
+    ../../DataSetProperties.cpp \
+    ../../axesdialog.cpp \
+    ../../datastream2d.cpp \
+    ../../journal.cpp \
+    ../../lineframer.cpp \
+    ../../outputwriter.cpp \
+    ../../pixeltransform.cpp \
+    ../../plot2d.cpp \
+    ../../plotpropertiesdlg.cpp \
+    ../../samplestore.cpp \
+    ../../textrecord.cpp \
+    ../../tpgparser.cpp
+
+HEADERS += \
+    ../../axesdialog.h \
+    ../../outputwriter.h \
+    ../../plot2d.h \
+    ../../plotpropertiesdlg.h
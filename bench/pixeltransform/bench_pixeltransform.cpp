@@ -0,0 +1,157 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+
+// transformAxis() throughput against the scalar mapping it replaced,
+// on 2^20 coordinates of a linear and of a log axis. The scalar rows
+// take the log10 per point, as the plot did, or read it from a column,
+// as DataStream2D now stores it. The program fails if any pixel or
+// mask differs from the scalar one.
+
+#include "pixeltransform.h"
+
+#include <QElapsedTimer>
+#include <QVector>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+
+
+static const int nValues = 1 << 20;
+static const int nPasses = 50;
+
+
+static void
+scalarLog10(const AxisTransform& t, const double* pValues, int n, int* pPixels, quint8* pMask) {
+    for(int i=0; i<n; i++) {
+        const double v = pValues[i];
+        if(t.bLog)
+            pPixels[i] = v > 0.0 ? int(t.origin + (log10(v) - t.vMin)*t.factor) : -INT_MAX;
+        else
+            pPixels[i] = int(t.origin + (v - t.vMin)*t.factor);
+        pMask[i] = (v >= t.lo && v <= t.hi) ? 1 : 0;
+    }
+}
+
+
+static void
+scalarColumn(const AxisTransform& t, const double* pValues, const double* pLogValues, int n,
+             int* pPixels, quint8* pMask) {
+    for(int i=0; i<n; i++) {
+        const double v = pValues[i];
+        if(t.bLog)
+            pPixels[i] = v > 0.0 ? int(t.origin + (pLogValues[i] - t.vMin)*t.factor) : -INT_MAX;
+        else
+            pPixels[i] = int(t.origin + (v - t.vMin)*t.factor);
+        pMask[i] = (v >= t.lo && v <= t.hi) ? 1 : 0;
+    }
+}
+
+
+static double
+pointsPerSecond(qint64 ns) {
+    return double(nValues)*nPasses/(ns*1.0e-9);
+}
+
+
+// Times the three mappings of one axis and checks that they agree
+static bool
+run(const char* sAxis, const AxisTransform& t, const QVector<double>& values) {
+    QVector<double> logValues(nValues);
+    for(int i=0; i<nValues; i++)
+        logValues[i] = log10(values.at(i));
+    QVector<int> reference(nValues), pixels(nValues);
+    QVector<quint8> referenceMask(nValues), mask(nValues);
+    QElapsedTimer timer;
+
+    timer.start();
+    for(int pass=0; pass<nPasses; pass++)
+        scalarLog10(t, values.constData(), nValues, reference.data(), referenceMask.data());
+    const qint64 nsLog10 = timer.nsecsElapsed();
+
+    timer.restart();
+    for(int pass=0; pass<nPasses; pass++)
+        scalarColumn(t, values.constData(), logValues.constData(), nValues,
+                     reference.data(), referenceMask.data());
+    const qint64 nsColumn = timer.nsecsElapsed();
+
+    timer.restart();
+    for(int pass=0; pass<nPasses; pass++)
+        transformAxis(t, values.constData(), logValues.constData(), nValues,
+                      pixels.data(), mask.data(), false);
+    const qint64 nsSimd = timer.nsecsElapsed();
+
+    int nDifferent = 0;
+    for(int i=0; i<nValues; i++)
+        if(pixels.at(i) != reference.at(i) || mask.at(i) != referenceMask.at(i))
+            nDifferent++;
+    if(t.bLog)
+        std::printf("%-6s %14.1f", sAxis, pointsPerSecond(nsLog10)*1.0e-6);
+    else
+        std::printf("%-6s %14s", sAxis, "-");
+    std::printf(" %14.1f %14.1f %10d\n",
+                pointsPerSecond(nsColumn)*1.0e-6, pointsPerSecond(nsSimd)*1.0e-6, nDifferent);
+    return nDifferent == 0;
+}
+
+
+int
+main() {
+    // A 800 x 600 frame; a tenth of the points out of the limits,
+    // and on the log axis one in a thousand not positive
+    QVector<double> linear(nValues), positive(nValues);
+    quint32 seed = 261;
+    for(int i=0; i<nValues; i++) {
+        seed = seed*1664525u + 1013904223u;
+        const double u = double(seed)/4294967296.0;
+        linear[i]   = -100.0 + 1100.0*u;
+        positive[i] = i % 1000 == 999 ? -u : pow(10.0, -10.0 + 13.0*u);
+    }
+    AxisTransform tx;
+    tx.lo     = 0.0;
+    tx.hi     = 1000.0;
+    tx.vMin   = tx.lo;
+    tx.factor = 800.0/(tx.hi-tx.lo);
+    tx.origin = 40.0;
+    tx.bLog   = false;
+    AxisTransform ty;
+    ty.lo     = 1.0e-9;
+    ty.hi     = 1.0e+3;
+    ty.vMin   = log10(ty.lo);
+    ty.factor = -600.0/(log10(ty.hi)-ty.vMin);
+    ty.origin = 620.0;
+    ty.bLog   = true;
+
+#if defined(__AVX2__)
+    const char* sSimd = "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    const char* sSimd = "SSE2";
+#else
+    const char* sSimd = "scalar";
+#endif
+    std::printf("transformAxis: %s, %d points x %d passes, M points/s\n", sSimd, nValues, nPasses);
+    std::printf("%-6s %14s %14s %14s %10s\n", "axis", "log10/point", "log10 column", "transformAxis", "different");
+    bool bOk = run("linear", tx, linear);
+    bOk = run("log", ty, positive) && bOk;
+    return bOk ? 0 : 1;
+}
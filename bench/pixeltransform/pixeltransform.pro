@@ -0,0 +1,12 @@
+# Build once more with QMAKE_CXXFLAGS+=-mavx2 for the AVX2 loop
+QT -= gui
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = bench_pixeltransform
+INCLUDEPATH += ../..
+
+SOURCES += \
+    bench_pixeltransform.cpp \
+    ../../pixeltransform.cpp
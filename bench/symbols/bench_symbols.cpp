@@ -0,0 +1,98 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+
+// ScatterPlot throughput in symbols/s on a 800 x 600 image, at device
+// pixel ratios 1 and 2. The first column draws the two lines of a plus
+// for every point, as ScatterPlot did before the sprites; the second
+// sends one drawPixmapFragments() call with a copy of a sprite drawn
+// once at the ratio of the image, scaled back by 1/dpr as in Plot2D.
+
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <QPixmap>
+#include <QtMath>
+#include <cstdio>
+
+
+static const int nSymbols    = 1000000;
+static const int symbolsDim  = 8;  // Plot2D::SYMBOLS_DIM
+static const int penWidth    = 1;
+
+
+static void
+drawPlus(QPainter* painter, int ix, int iy) {
+    painter->drawLine(ix, iy-symbolsDim/2, ix, iy+symbolsDim/2+1);
+    painter->drawLine(ix-symbolsDim/2, iy, ix+symbolsDim/2+1, iy);
+}
+
+
+int
+main(int argc, char *argv[]) {
+    QGuiApplication application(argc, argv);
+    QVector<QPoint> points(nSymbols);
+    quint32 seed = 261;
+    for(int i=0; i<nSymbols; i++) {
+        seed = seed*1664525u + 1013904223u;
+        points[i] = QPoint(20 + int(seed % 760u), 20 + int((seed >> 10) % 560u));
+    }
+    const QPen pen(Qt::yellow, penWidth);
+
+    std::printf("%4s %18s %18s\n", "dpr", "lines [M/s]", "sprites [M/s]");
+    for(int dpr=1; dpr<=2; dpr++) {
+        QImage image(800*dpr, 600*dpr, QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(dpr);
+        image.fill(Qt::black);
+        QPainter painter(&image);
+        painter.setPen(pen);
+        QElapsedTimer timer;
+        timer.start();
+        for(const QPoint& point : points)
+            drawPlus(&painter, point.x(), point.y());
+        const qint64 nsLines = timer.nsecsElapsed();
+
+        image.fill(Qt::black);
+        timer.restart();
+        const int side = 2*(symbolsDim + penWidth + 2);
+        QPixmap sprite(qCeil(side*dpr), qCeil(side*dpr));
+        sprite.setDevicePixelRatio(dpr);
+        sprite.fill(Qt::transparent);
+        QPainter spritePainter(&sprite);
+        spritePainter.setPen(pen);
+        drawPlus(&spritePainter, side/2, side/2);
+        spritePainter.end();
+        const QRectF source(0.0, 0.0, sprite.width(), sprite.height());
+        QVector<QPainter::PixmapFragment> fragments;
+        fragments.reserve(nSymbols);
+        for(const QPoint& point : points)
+            fragments.append(QPainter::PixmapFragment::create(QPointF(point), source, 1.0/dpr, 1.0/dpr));
+        painter.drawPixmapFragments(fragments.constData(), fragments.count(), sprite);
+        const qint64 nsSprites = timer.nsecsElapsed();
+        painter.end();
+
+        std::printf("%4d %18.2f %18.2f\n", dpr, nSymbols*1.0e3/nsLines, nSymbols*1.0e3/nsSprites);
+    }
+    return 0;
+}
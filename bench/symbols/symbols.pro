@@ -0,0 +1,11 @@
+# QPainter on a QImage: no window is opened
+QT += gui
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = bench_symbols
+INCLUDEPATH += ../..
+
+SOURCES += \
+    bench_symbols.cpp
@@ -0,0 +1,109 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+// Text log formatting: lines/s of TextRecordEncoder against the
+// QString::arg() formatting it replaces and against snprintf().
+// Each program writes the same records into a reused byte buffer.
+
+#include "textrecord.h"
+
+#include <QElapsedTimer>
+#include <QString>
+#include <cstdio>
+
+
+static const int nRecords = 2000000;
+
+
+static double
+time(int i) {
+    return i*0.1;
+}
+
+
+static double
+pressure(int i) {
+    return 1.0e-9*(1+i%999983);
+}
+
+
+static double
+qstringLinesPerSecond() {
+    QByteArray out;
+    out.reserve(64 << 20);
+    QElapsedTimer timer;
+    timer.start();
+    for(int i=0; i<nRecords; i++) {
+        if(out.size() > (60 << 20))
+            out.resize(0);
+        QString sData = QString("%1 %2\n")
+                        .arg(time(i), 16, 'f', 6, ' ')
+                        .arg(pressure(i), 12, 'g', 6, ' ');
+        out.append(sData.toLocal8Bit());
+    }
+    return nRecords/(timer.nsecsElapsed()*1.0e-9);
+}
+
+
+static double
+snprintfLinesPerSecond() {
+    QByteArray out;
+    out.resize(64 << 20);
+    int nBytes = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for(int i=0; i<nRecords; i++) {
+        if(nBytes > (60 << 20))
+            nBytes = 0;
+        nBytes += std::snprintf(out.data()+nBytes, TextRecordEncoder::maxRecordLength,
+                                "%16.6f %12.6g\n", time(i), pressure(i));
+    }
+    return nRecords/(timer.nsecsElapsed()*1.0e-9);
+}
+
+
+static double
+encoderLinesPerSecond() {
+    TextRecordEncoder encoder;
+    QElapsedTimer timer;
+    timer.start();
+    for(int i=0; i<nRecords; i++) {
+        if(encoder.size() > (60 << 20))
+            encoder.clear();
+        encoder.append(time(i), pressure(i));
+    }
+    return nRecords/(timer.nsecsElapsed()*1.0e-9);
+}
+
+
+int
+main() {
+    const double qstring  = qstringLinesPerSecond();
+    const double snprintf = snprintfLinesPerSecond();
+    const double encoder  = encoderLinesPerSecond();
+    std::printf("%-20s %14s %10s\n", "formatting", "lines/s", "speedup");
+    std::printf("%-20s %14.0f %10.1f\n", "QString::arg", qstring, 1.0);
+    std::printf("%-20s %14.0f %10.1f\n", "snprintf", snprintf, snprintf/qstring);
+    std::printf("%-20s %14.0f %10.1f\n", "TextRecordEncoder", encoder, encoder/qstring);
+    return 0;
+}
@@ -0,0 +1,11 @@
+QT -= gui
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = bench_textrecord
+INCLUDEPATH += ../..
+
+SOURCES += \
+    bench_textrecord.cpp \
+    ../../textrecord.cpp
@@ -0,0 +1,99 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+
+// Load Run throughput: a text run of 1 GB (or of the MB given as the
+// first argument) is written with TextRecordEncoder, memory mapped and
+// parsed with TextRunParser, first as a single chunk and then split in
+// 8 MB chunks handed to QtConcurrent, as MainWindow::parseTextRun() does.
+
+#include "textrecord.h"
+#include "textrunparser.h"
+
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QtConcurrent>
+#include <cstdio>
+#include <cstdlib>
+
+
+static bool
+writeRun(QFile& file, qint64 size) {
+    TextRecordEncoder encoder;
+    qint64 nWritten = 0;
+    for(qint64 i=0; nWritten<size; i++) {
+        encoder.append(i*0.1, 1.0e-9*(1+i%999983));
+        if(encoder.size() > (1 << 20)) {
+            if(file.write(encoder.data(), encoder.size()) != encoder.size())
+                return false;
+            nWritten += encoder.size();
+            encoder.clear();
+        }
+    }
+    return true;
+}
+
+
+static void
+report(const char* sName, int nChunks, qint64 size, qint64 nLines, qint64 ns) {
+    const double seconds = ns*1.0e-9;
+    std::printf("%-12s %8d %10.0f %12.1f\n",
+                sName, nChunks, size/seconds/1.0e6, nLines/seconds/1.0e6);
+}
+
+
+int
+main(int argc, char* argv[]) {
+    const qint64 size = qint64(argc > 1 ? std::atoi(argv[1]) : 1000) * 1000000;
+    QTemporaryFile file;
+    if(!file.open() || !writeRun(file, size)) {
+        std::printf("Error writing %s\n", qPrintable(file.fileName()));
+        return 1;
+    }
+    file.flush();
+    const qint64 fileSize = file.size();
+    const char* pData = reinterpret_cast<const char*>(file.map(0, fileSize));
+    if(!pData) {
+        std::printf("Error mapping %s\n", qPrintable(file.fileName()));
+        return 1;
+    }
+    std::printf("%lld MB, %d threads\n", fileSize/1000000, QThread::idealThreadCount());
+    std::printf("%-12s %8s %10s %12s\n", "parse", "chunks", "MB/s", "M lines/s");
+
+    QElapsedTimer timer;
+    QVector<TextRunParser::Chunk> chunks = TextRunParser::split(pData, fileSize, 1);
+    timer.start();
+    TextRunParser::parse(chunks[0]);
+    report("sequential", 1, fileSize, chunks.at(0).x.count(), timer.nsecsElapsed());
+    chunks.clear();
+
+    const int nChunks = int(qMax(qint64(QThread::idealThreadCount()), fileSize >> 23));
+    timer.start();
+    chunks = TextRunParser::split(pData, fileSize, nChunks);
+    QtConcurrent::blockingMap(chunks, TextRunParser::parse);
+    QVector<double> x, y;
+    TextRunParser::join(chunks, x, y);
+    report("QtConcurrent", chunks.count(), fileSize, x.count(), timer.nsecsElapsed());
+    return 0;
+}
@@ -0,0 +1,13 @@
+QT -= gui
+QT += concurrent
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = bench_textrunparser
+INCLUDEPATH += ../..
+
+SOURCES += \
+    bench_textrunparser.cpp \
+    ../../textrecord.cpp \
+    ../../textrunparser.cpp
@@ -0,0 +1,100 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+// parseTpgMeasurement() throughput and allocations.
+// The global operator new is replaced to count every heap allocation
+// made while the records are parsed: the expected count is zero.
+
+#include "tpgparser.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+
+static long long nAllocations = 0;
+
+
+void*
+operator new(std::size_t size) {
+    nAllocations++;
+    if(void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+
+void
+operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+
+void
+operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+
+int
+main() {
+    const int nRecords = 1 << 20;
+    std::vector<std::string> records;
+    records.reserve(nRecords);
+    char record[32];
+    for(int i=0; i<nRecords; i++) {
+        std::snprintf(record, sizeof(record), "%d,+%d.%04dE-%02d",
+                      i%3, 1+i%9, i%10000, i%10);
+        records.push_back(record);
+    }
+
+    const int nPasses = 10;
+    double sum = 0.0;
+    long long nParsed = 0;
+    const long long allocationsBefore = nAllocations;
+    const auto start = std::chrono::steady_clock::now();
+    for(int pass=0; pass<nPasses; pass++) {
+        for(const std::string& line : records) {
+            int status;
+            double pressure;
+            if(parseTpgMeasurement(line.data(), int(line.size()), status, pressure)) {
+                sum += pressure;
+                nParsed++;
+            }
+        }
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    const long long allocations = nAllocations - allocationsBefore;
+    const double seconds = std::chrono::duration<double>(stop-start).count();
+
+    std::printf("records parsed:         %lld (checksum %g)\n", nParsed, sum);
+    std::printf("samples/s:              %.0f\n", nParsed/seconds);
+    std::printf("ns/sample:              %.1f\n", seconds*1.0e9/nParsed);
+    std::printf("allocations:            %lld\n", allocations);
+    std::printf("allocations per sample: %g\n", double(allocations)/nParsed);
+    return allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+# No Qt: the parser itself does not use it
+CONFIG += console c++17
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = bench_tpgparser
+INCLUDEPATH += ../..
+
+SOURCES += \
+    bench_tpgparser.cpp \
+    ../../tpgparser.cpp
@@ -0,0 +1,324 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include "binarylog.h"
+#include "textrecord.h"
+#include "pressuresample.h"
+
+#include <QStringList>
+#include <cstring>
+
+
+static const char headerMagic[8] = {'T','P','G','2','6','1','B','\n'};
+static const char blockMagic[4]  = {'B','L','K','1'};
+static const quint32 logFileVersion = 1;
+
+
+// The info text is truncated if it does not fit in the header
+QByteArray
+logFileHeader(const char* pMagic, const QString& sInfo, qint64 startMsecsSinceEpoch, int samplesPerBlock) {
+    QByteArray buffer(sizeof(BinaryLogHeader), '\0');
+    BinaryLogHeader* pHeader = reinterpret_cast<BinaryLogHeader*>(buffer.data());
+    QByteArray info = sInfo.toUtf8().left(int(sizeof(pHeader->info)));
+    std::memcpy(pHeader->magic, pMagic, sizeof(pHeader->magic));
+    pHeader->version              = logFileVersion;
+    pHeader->size                 = BinaryLogHeader::headerSize;
+    pHeader->blockSamples         = quint32(samplesPerBlock);
+    pHeader->infoLength           = quint32(info.size());
+    pHeader->startMsecsSinceEpoch = startMsecsSinceEpoch;
+    std::memcpy(pHeader->info, info.constData(), size_t(info.size()));
+    return buffer;
+}
+
+
+const BinaryLogHeader*
+checkLogHeader(const uchar* pMap, qint64 mapSize, const char* pMagic, QString& sError) {
+    const BinaryLogHeader* pHeader = reinterpret_cast<const BinaryLogHeader*>(pMap);
+    if(mapSize < qint64(sizeof(BinaryLogHeader)) ||
+       std::memcmp(pHeader->magic, pMagic, sizeof(pHeader->magic)) ||
+       pHeader->size != BinaryLogHeader::headerSize ||
+       pHeader->infoLength > sizeof(pHeader->info))
+    {
+        sError = QString("Not a %1 file").arg(QString::fromLatin1(pMagic, 7));
+        return nullptr;
+    }
+    if(pHeader->version != logFileVersion) {
+        sError = QString("Unsupported file version %1").arg(pHeader->version);
+        return nullptr;
+    }
+    return pHeader;
+}
+
+
+BinaryLogEncoder::BinaryLogEncoder(int samplesPerBlock)
+    : blockSamples(samplesPerBlock)
+{
+    times.reserve(blockSamples);
+    pressures.reserve(blockSamples);
+    statuses.reserve(blockSamples);
+    blockBuffer.reserve(blockBytes(blockSamples));
+}
+
+
+QByteArray
+BinaryLogEncoder::header(const QString& sInfo, qint64 startMsecsSinceEpoch, int samplesPerBlock) {
+    return logFileHeader(headerMagic, sInfo, startMsecsSinceEpoch, samplesPerBlock);
+}
+
+
+int
+BinaryLogEncoder::blockBytes(int count) {
+    int nBytes = int(sizeof(BinaryLogBlockHeader)) + count*(2*int(sizeof(double))+1);
+    return (nBytes+7) & ~7;
+}
+
+
+void
+BinaryLogEncoder::append(double time, double pressure, int status) {
+    times.append(time);
+    pressures.append(pressure);
+    statuses.append(quint8(status));
+}
+
+
+int
+BinaryLogEncoder::pendingSamples() const {
+    return times.count();
+}
+
+
+bool
+BinaryLogEncoder::isBlockFull() const {
+    return times.count() >= blockSamples;
+}
+
+
+// Encodes the pending samples as a (possibly short) block.
+// The returned buffer is valid until the next call.
+const QByteArray&
+BinaryLogEncoder::finishBlock() {
+    const int count = times.count();
+    blockBuffer.fill('\0', blockBytes(count));
+    char* p = blockBuffer.data();
+    BinaryLogBlockHeader blockHeader;
+    std::memcpy(blockHeader.magic, blockMagic, sizeof(blockMagic));
+    blockHeader.count = quint32(count);
+    std::memcpy(p, &blockHeader, sizeof(blockHeader));
+    p += sizeof(blockHeader);
+    std::memcpy(p, times.constData(), count*sizeof(double));
+    p += count*sizeof(double);
+    std::memcpy(p, pressures.constData(), count*sizeof(double));
+    p += count*sizeof(double);
+    std::memcpy(p, statuses.constData(), size_t(count));
+    times.resize(0);
+    pressures.resize(0);
+    statuses.resize(0);
+    return blockBuffer;
+}
+
+
+BinaryLogReader::BinaryLogReader()
+    : pMap(nullptr)
+    , pHeader(nullptr)
+    , nSamples(0)
+{
+}
+
+
+BinaryLogReader::~BinaryLogReader() {
+    close();
+}
+
+
+// Only the block headers are visited: the columns are used
+// in place from the mapped file.
+bool
+BinaryLogReader::open(QString sFileName) {
+    close();
+    file.setFileName(sFileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        sError = file.errorString();
+        return false;
+    }
+    const qint64 fileSize = file.size();
+    pMap = fileSize > 0 ? file.map(0, fileSize) : nullptr;
+    if(!pMap) {
+        sError = fileSize > 0 ? file.errorString() : QString("Empty file");
+        close();
+        return false;
+    }
+    pHeader = checkLogHeader(pMap, fileSize, headerMagic, sError);
+    if(!pHeader) {
+        close();
+        return false;
+    }
+    qint64 offset = pHeader->size;
+    while(offset+qint64(sizeof(BinaryLogBlockHeader)) <= fileSize) {
+        BinaryLogBlockHeader blockHeader;
+        std::memcpy(&blockHeader, pMap+offset, sizeof(blockHeader));
+        if(std::memcmp(blockHeader.magic, blockMagic, sizeof(blockMagic)))
+            break;
+        // The count is checked in 64 bits, before any offset is derived
+        // from it: no block is longer than the nominal one, nor than
+        // what is left of the file
+        const qint64 count  = blockHeader.count;
+        const qint64 nBytes = (qint64(sizeof(blockHeader)) + count*(2*qint64(sizeof(double))+1) + 7) & ~qint64(7);
+        if(count > qint64(pHeader->blockSamples) || nBytes > fileSize-offset)
+            break; // Truncated by a crash: keep what precedes it
+        const uchar* p = pMap + offset + sizeof(blockHeader);
+        Block block;
+        block.count     = int(count);
+        block.pTime     = reinterpret_cast<const double*>(p);
+        block.pPressure = reinterpret_cast<const double*>(p + count*sizeof(double));
+        block.pStatus   = p + 2*count*sizeof(double);
+        blocks.append(block);
+        nSamples += count;
+        offset   += nBytes;
+    }
+    return true;
+}
+
+
+void
+BinaryLogReader::close() {
+    blocks.clear();
+    nSamples = 0;
+    pHeader  = nullptr;
+    if(pMap)
+        file.unmap(pMap);
+    pMap = nullptr;
+    if(file.isOpen())
+        file.close();
+}
+
+
+QString
+BinaryLogReader::errorString() const {
+    return sError;
+}
+
+
+QString
+BinaryLogReader::info() const {
+    if(!pHeader)
+        return QString();
+    return QString::fromUtf8(pHeader->info, int(pHeader->infoLength));
+}
+
+
+qint64
+BinaryLogReader::startMsecsSinceEpoch() const {
+    return pHeader ? pHeader->startMsecsSinceEpoch : 0;
+}
+
+
+qint64
+BinaryLogReader::sampleCount() const {
+    return nSamples;
+}
+
+
+int
+BinaryLogReader::blockCount() const {
+    return blocks.count();
+}
+
+
+const BinaryLogReader::Block&
+BinaryLogReader::block(int i) const {
+    return blocks.at(i);
+}
+
+
+bool
+convertTextToBinary(QString sTextFile, QString sBinaryFile, QString& sError) {
+    TextLogReader reader;
+    if(!reader.open(sTextFile)) {
+        sError = QString("%1: %2").arg(sTextFile, reader.errorString());
+        return false;
+    }
+    QFile outFile(sBinaryFile);
+    if(!outFile.open(QIODevice::WriteOnly)) {
+        sError = QString("%1: %2").arg(sBinaryFile, outFile.errorString());
+        return false;
+    }
+    BinaryLogEncoder encoder;
+    double time, pressure;
+    // The header is complete once the first record has been read
+    bool bRecord = reader.next(time, pressure);
+    outFile.write(BinaryLogEncoder::header(reader.infoLines().join('\n'),
+                                           reader.startMsecsSinceEpoch()));
+    while(bRecord) {
+        encoder.append(time, pressure, PressureSample::MeasurementOk);
+        if(encoder.isBlockFull())
+            outFile.write(encoder.finishBlock());
+        bRecord = reader.next(time, pressure);
+    }
+    if(encoder.pendingSamples() > 0)
+        outFile.write(encoder.finishBlock());
+    if(outFile.error() != QFileDevice::NoError) {
+        sError = QString("%1: %2").arg(sBinaryFile, outFile.errorString());
+        return false;
+    }
+    return true;
+}
+
+
+// Samples without a valid pressure are not written,
+// as in the text files written during the acquisition.
+bool
+convertBinaryToText(QString sBinaryFile, QString sTextFile, QString& sError) {
+    BinaryLogReader reader;
+    if(!reader.open(sBinaryFile)) {
+        sError = QString("%1: %2").arg(sBinaryFile, reader.errorString());
+        return false;
+    }
+    QFile outFile(sTextFile);
+    if(!outFile.open(QIODevice::WriteOnly|QIODevice::Text)) {
+        sError = QString("%1: %2").arg(sTextFile, outFile.errorString());
+        return false;
+    }
+    QStringList infoLines;
+    if(!reader.info().isEmpty())
+        infoLines = reader.info().split('\n');
+    outFile.write(TextRecordEncoder::header(infoLines));
+    TextRecordEncoder encoder;
+    for(int iBlock=0; iBlock<reader.blockCount(); iBlock++) {
+        const BinaryLogReader::Block& block = reader.block(iBlock);
+        for(int i=0; i<block.count; i++) {
+            if(block.pStatus[i] > PressureSample::Overrange)
+                continue;
+            encoder.append(block.pTime[i], block.pPressure[i]);
+        }
+        if(encoder.size() > (1 << 20)) {
+            outFile.write(encoder.data(), encoder.size());
+            encoder.clear();
+        }
+    }
+    outFile.write(encoder.data(), encoder.size());
+    if(outFile.error() != QFileDevice::NoError) {
+        sError = QString("%1: %2").arg(sTextFile, outFile.errorString());
+        return false;
+    }
+    return true;
+}
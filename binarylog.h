@@ -0,0 +1,122 @@
+// MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+
+// Columnar acquisition file:
+//    a BinaryLogHeader of headerSize bytes, then a sequence of blocks
+//    made of a BinaryLogBlockHeader, count double times [s],
+//    count double pressures and count uint8 gauge status codes,
+//    zero padded to a multiple of 8 bytes.
+// Values are stored in the host (little endian) byte order so that
+// a memory mapped file can be handed directly to the plot.
+struct BinaryLogHeader
+{
+    enum { headerSize = 4096 };
+    char    magic[8];             // "TPG261B\n"
+    quint32 version;
+    quint32 size;                 // == headerSize
+    quint32 blockSamples;         // Nominal samples per block
+    quint32 infoLength;           // Bytes used in info
+    qint64  startMsecsSinceEpoch; // Wall clock at Time = 0 s
+    char    info[headerSize-32];  // The text file comment lines (UTF-8, no "# ")
+};
+static_assert(sizeof(BinaryLogHeader) == BinaryLogHeader::headerSize,
+              "BinaryLogHeader must have a fixed size");
+
+
+// Also used, with its own magic, by the compressed files
+QByteArray logFileHeader(const char* pMagic, const QString& sInfo,
+                         qint64 startMsecsSinceEpoch, int samplesPerBlock);
+const BinaryLogHeader* checkLogHeader(const uchar* pMap, qint64 mapSize,
+                                      const char* pMagic, QString& sError);
+
+
+struct BinaryLogBlockHeader
+{
+    char    magic[4];             // "BLK1"
+    quint32 count;
+};
+
+
+class BinaryLogEncoder
+{
+public:
+    static const int defaultBlockSamples = 4096;
+
+    explicit BinaryLogEncoder(int samplesPerBlock = defaultBlockSamples);
+    static QByteArray header(const QString& sInfo, qint64 startMsecsSinceEpoch,
+                             int samplesPerBlock = defaultBlockSamples);
+    static int blockBytes(int count);
+    void append(double time, double pressure, int status);
+    int  pendingSamples() const;
+    bool isBlockFull() const;
+    const QByteArray& finishBlock();
+
+protected:
+    int             blockSamples;
+    QVector<double> times;
+    QVector<double> pressures;
+    QVector<quint8> statuses;
+    QByteArray      blockBuffer;
+};
+
+
+class BinaryLogReader
+{
+public:
+    struct Block {
+        const double* pTime;
+        const double* pPressure;
+        const quint8* pStatus;
+        int           count;
+    };
+
+    BinaryLogReader();
+    ~BinaryLogReader();
+    bool open(QString sFileName);
+    void close();
+    QString errorString() const;
+    QString info() const;
+    qint64 startMsecsSinceEpoch() const;
+    qint64 sampleCount() const;
+    int blockCount() const;
+    const Block& block(int i) const;
+
+protected:
+    QFile          file;
+    uchar*         pMap;
+    const BinaryLogHeader* pHeader;
+    QVector<Block> blocks;
+    qint64         nSamples;
+    QString        sError;
+};
+
+
+bool convertTextToBinary(QString sTextFile, QString sBinaryFile, QString& sError);
+bool convertBinaryToText(QString sBinaryFile, QString sTextFile, QString& sError);
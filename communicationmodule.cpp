@@ -22,19 +22,20 @@
 */
 
 #include "communicationmodule.h"
-
-#include <QThread>
-#include <QDebug>
-#include <QDateTime>
-#include <QMessageBox>
-#include <QCoreApplication>
+#include "pressuresample.h"
 
 
 CommunicationModule::CommunicationModule(QObject *parent)
     : QObject(parent)
     , sFilename(QString("/dev/ttyUSB0"))
+    , serialPort(this) // Parented, so it follows us into the acquisition thread
     , serialPortName(sFilename)
-    , receivedData(QString())
+    , lineFramer(4096)
+    , currentLineNs(0)
+    , protocolState(Idle)
+    , replyTimer(this)
+    , bTransmissionStopped(false)
+    , bPolling(false)
 {
     serialPort.setPortName(serialPortName);
 // Data Format:
@@ -50,7 +51,9 @@ CommunicationModule::CommunicationModule(QObject *parent)
     serialPort.setFlowControl(QSerialPort::NoFlowControl);
     if(serialPort.isOpen()) // Already Open ?
         serialPort.close(); // Close it !
-    //serialPort.setParent(this);
+    replyTimer.setSingleShot(true);
+    connect(&replyTimer, SIGNAL(timeout()),
+            this, SLOT(onReplyTimeout()));
 }
 
 
@@ -61,108 +64,308 @@ CommunicationModule::~CommunicationModule() {
 }
 
 
+// Takes effect at the next startConnection()
+void
+CommunicationModule::setPortParameters(QString sPortName, int baudRate) {
+    if(serialPort.isOpen() && sPortName != serialPortName) {
+        stopPolling();
+        serialPort.close();
+        lineFramer.clear();
+    }
+    sFilename      = sPortName;
+    serialPortName = sPortName;
+    serialPort.setPortName(serialPortName);
+    serialPort.setBaudRate(baudRate);
+}
+
+
+// Immediate, also on an open port
+void
+CommunicationModule::setBaudRate(int baudRate) {
+    serialPort.setBaudRate(baudRate);
+    lineFramer.clear();
+}
+
+
+// Runs in the acquisition thread: no GUI here.
+// Errors are reported with the connectionError() signal.
 bool
 CommunicationModule::startConnection() {
-    if(!serialPort.open(QIODevice::ReadWrite)) {
-        QMessageBox msgBox;
-        msgBox.setWindowTitle(QCoreApplication::applicationName());
-        msgBox.setIcon(QMessageBox::Critical);
-        msgBox.setText(QString("Error Opening Device File.\n%1")
-                       .arg(serialPort.errorString()));
-        msgBox.setInformativeText(sFilename);
-        msgBox.setStandardButtons(QMessageBox::Close);
-        msgBox.setDefaultButton(QMessageBox::Close);
-        msgBox.exec();
+    if(!serialPort.isOpen() && !serialPort.open(QIODevice::ReadWrite)) {
+        emit connectionError(serialPort.errorString(), sFilename);
         return false;
     }
     connect(&serialPort, SIGNAL(readyRead()),
-            this, SLOT(onNewDataAvailable()));
+            this, SLOT(onNewDataAvailable()),
+            Qt::UniqueConnection);
     return true;
 }
 
+
+// Reads the serial port straight into the framer and hands all the
+// complete lines received to the listeners in a single batch.
+// The QByteArrays in the batch are views on the framer ring: they are
+// only valid during the (direct) call of the slots connected to newLines().
+// Each line is stamped with the monotonic time its LF arrived, estimated
+// from the time of the read and the bytes that followed the LF on the wire
+// (10 bits per byte: start + 8 data + stop).
 void
 CommunicationModule::onNewDataAvailable() {
-    receivedData += serialPort.readAll();
-    int lineLen = receivedData.indexOf('\n');
-    if(lineLen < 0) return;
-    lineLen++;
-    emit newData(receivedData.left(lineLen).remove('\r').remove('\n'));
-    receivedData.remove(0, lineLen);
-}
-
-
-QString
-CommunicationModule::BlockingQuery(QString queryString) {
-    sCommand = queryString.remove('\r').remove('\n');
-    sCommand.append("\r\n");
-//    qDebug() << sCommand;
-    semaphore.lock();
-    if(serialPort.write(queryString.toLocal8Bit()) != queryString.length()) {
-        semaphore.unlock();
-        return  QString();
+    const qint64 nsPerByte = 10000000000LL / qMax(qint32(1), serialPort.baudRate());
+    while(serialPort.bytesAvailable() > 0) {
+        int nFree;
+        char* pFree = lineFramer.writePointer(nFree);
+        if(nFree == 0) { // A "line" longer than the whole ring: resync
+            lineFramer.clear();
+            continue;
+        }
+        qint64 nRead = serialPort.read(pFree, nFree);
+        if(nRead <= 0)
+            break;
+        const qint64 readNs = monotonicNSecs();
+        lineFramer.commit(int(nRead));
+        lineBatch.clear();
+        lineBytesAfter.clear();
+        if(lineFramer.takeLines(lineBatch, lineBytesAfter) == 0)
+            continue;
+        lineArrivalNs.resize(lineBatch.count());
+        for(int i=0; i<lineBatch.count(); i++)
+            lineArrivalNs[i] = readNs - lineBytesAfter.at(i)*nsPerByte;
+        if(protocolState != Idle) {
+            // Take out the protocol answers, keep the measurements
+            int nKept = 0;
+            for(int i=0; i<lineBatch.count(); i++) {
+                currentLineNs = lineArrivalNs.at(i);
+                if(protocolState != Idle && processProtocolLine(lineBatch.at(i)))
+                    continue;
+                if(nKept != i) {
+                    lineBatch[nKept]     = lineBatch.at(i);
+                    lineArrivalNs[nKept] = lineArrivalNs.at(i);
+                }
+                nKept++;
+            }
+            lineBatch.resize(nKept);
+            lineArrivalNs.resize(nKept);
+        }
+        if(!lineBatch.isEmpty())
+            emit newLines(lineBatch, lineArrivalNs);
     }
-    serialPort.flush();
-    // Some time is needed from a request to a response
-    QThread::msleep(200);
-    // Read the instrument.
-    QString sAnswer = QString(serialPort.readLine()).remove('\r').remove('\n');
-    semaphore.unlock();
-    return sAnswer;
 }
 
 
+// Fire and forget: the <ACK> is consumed by the protocol engine.
 bool
 CommunicationModule::writeCommand(QString sCommand) {
-    sCommand = sCommand.remove('\r').remove('\n');
-    sCommand.append("\r\n");
-//    qDebug() << sCommand;
-    semaphore.lock();
-    if(serialPort.write(sCommand.toLocal8Bit()) != sCommand.length()) {
-        semaphore.unlock();
+    if(!serialPort.isOpen())
         return false;
-    }
-    serialPort.flush();
-    semaphore.unlock();
+    sCommand = sCommand.remove('\r').remove('\n');
+    sendRequest(sCommand.toLatin1(), false, ReplyHandler());
     return true;
 }
 
 
-QString
-CommunicationModule::Query(QString queryString) {
-//    qDebug() << queryString;
-    semaphore.lock();
-    if(!queryString.endsWith('\n'))
-        queryString.append('\n');
-    if(serialPort.write(queryString.toLocal8Bit()) != queryString.length()) {
-        semaphore.unlock();
-        return QString();
+CommunicationModule::Request::Request(QByteArray myMnemonic,
+                                      bool myEnquire,
+                                      ReplyHandler handler,
+                                      int myTimeoutMs)
+    : mnemonic(myMnemonic)
+    , bEnquire(myEnquire)
+    , timeoutMs(myTimeoutMs)
+{
+    if(handler)
+        handlers.append(handler);
+}
+
+
+// A plain parameter read ("UNI"), as opposed to a parameter
+// modification ("UNI,1") or a command without answer ("COM,1")
+bool
+CommunicationModule::Request::isRead() const {
+    return bEnquire && !mnemonic.contains(',');
+}
+
+
+// Event driven implementation of the TPG 261 handshake:
+//    HOST: mnemonic<CR><LF>  ->  TPG: <ACK><CR><LF> (or <NAK><CR><LF>)
+//    HOST: <ENQ>             ->  TPG: answer<CR><LF>
+// Requests are served one at a time in the order they are queued and
+// each one completes as soon as the gauge answers (or timeoutMs elapses).
+// Must be called in the acquisition thread.
+void
+CommunicationModule::sendRequest(QByteArray mnemonic,
+                                 bool bEnquire,
+                                 ReplyHandler handler,
+                                 int timeoutMs)
+{
+    enqueueRequest(Request(mnemonic, bEnquire, handler, timeoutMs));
+    startNextRequest();
+}
+
+
+// Queues all the requests of the batch before starting the first one,
+// so they are sent back to back and the continuous transmission
+// (stopped by the first character we send) is resumed only once,
+// after the last answer.
+void
+CommunicationModule::sendBatch(const QList<Request>& batch) {
+    for(int i=0; i<batch.count(); i++)
+        enqueueRequest(batch.at(i));
+    startNextRequest();
+}
+
+
+// Reads of a parameter already waiting in the queue are collapsed into
+// the queued one, unless a modification of the same parameter is queued
+// in between.
+void
+CommunicationModule::enqueueRequest(const Request& request) {
+    if(request.isRead()) {
+        for(int i=requestQueue.count()-1; i>=0; i--) {
+            Request& queued = requestQueue[i];
+            if(queued.mnemonic == request.mnemonic && queued.isRead()) {
+                queued.handlers.append(request.handlers);
+                return;
+            }
+            if(queued.mnemonic.startsWith(request.mnemonic + ','))
+                break;
+        }
+    }
+    requestQueue.enqueue(request);
+}
+
+
+void
+CommunicationModule::startNextRequest() {
+    if(protocolState != Idle || requestQueue.isEmpty())
+        return;
+    currentRequest = requestQueue.dequeue();
+    if(currentRequest.mnemonic.startsWith("COM"))
+        bTransmissionStopped = false;
+    else if(!continuousCommand.isEmpty())
+        bTransmissionStopped = true; // Any character stops it
+    QByteArray command = currentRequest.mnemonic + "\r\n";
+    if(serialPort.write(command) != command.size()) {
+        protocolState = WaitingAck; // So that completeRequest() can run
+        completeRequest(false, QByteArray());
+        return;
     }
     serialPort.flush();
-    // Some time is needed from a request to a response
-    QThread::msleep(200);
-    // Read the instrument.
-    QString sString = QString(serialPort.readLine()).remove('\r').remove('\n');
-    semaphore.unlock();
-    return sString;
-}
-
-
-QByteArray
-CommunicationModule::BinaryQuery(QString queryString) {
-//    qDebug() << queryString;
-    semaphore.lock();
-    if(!queryString.endsWith('\n'))
-        queryString.append('\n');
-    if(serialPort.write(queryString.toLocal8Bit()) != queryString.length()) {
-        semaphore.unlock();
-        return QByteArray();
+    protocolState = WaitingAck;
+    replyTimer.start(currentRequest.timeoutMs);
+}
+
+
+// Returns true if line was an answer to the pending request.
+bool
+CommunicationModule::processProtocolLine(const QByteArray& line) {
+    const char ACK = 0x06;
+    const char NAK = 0x15;
+    const char ENQ = 0x05;
+    const char cLast = line.at(line.size()-1);
+    if(protocolState == WaitingAck) {
+        if(cLast == NAK) {
+            completeRequest(false, QByteArray());
+            return true;
+        }
+        if(cLast != ACK)
+            return false; // A measurement still in flight
+        if(!currentRequest.bEnquire) {
+            completeRequest(true, QByteArray());
+            return true;
+        }
+        if(serialPort.write(&ENQ, 1) != 1) {
+            completeRequest(false, QByteArray());
+            return true;
+        }
+        serialPort.flush();
+        protocolState = WaitingReply;
+        replyTimer.start(currentRequest.timeoutMs);
+        return true;
+    }
+    if(protocolState == WaitingReply) {
+        if(cLast == NAK)
+            completeRequest(false, QByteArray());
+        else // line is a view on the framer: copy it
+            completeRequest(true, QByteArray(line.constData(), line.size()));
+        return true;
     }
+    return false;
+}
+
+
+void
+CommunicationModule::onReplyTimeout() {
+    if(protocolState == Idle)
+        return;
+    const char ETX = 0x03; // Clears the input buffer of the TPG 261
+    serialPort.write(&ETX, 1);
     serialPort.flush();
-    // Some time is needed from a request to a response
-    QThread::msleep(200);
-    // Read the instrument.
-    QByteArray sBinaryBlock = serialPort.readLine();
-    semaphore.unlock();
-    return sBinaryBlock;
+    emit warning(QString("TPG 261 did not answer to %1")
+                 .arg(QString::fromLatin1(currentRequest.mnemonic)));
+    completeRequest(false, QByteArray());
 }
 
+
+void
+CommunicationModule::completeRequest(bool bOk, QByteArray reply) {
+    replyTimer.stop();
+    protocolState = Idle;
+    if(bOk && currentRequest.mnemonic.startsWith("COM"))
+        continuousCommand = currentRequest.mnemonic;
+    QList<ReplyHandler> handlers = currentRequest.handlers;
+    currentRequest.handlers.clear();
+    for(int i=0; i<handlers.count(); i++) {
+        if(handlers.at(i))
+            handlers.at(i)(bOk, reply);
+    }
+    // Once the queue is empty resume the continuous transmission
+    if(protocolState == Idle && requestQueue.isEmpty() &&
+       bTransmissionStopped && !continuousCommand.isEmpty())
+        enqueueRequest(Request(continuousCommand, false));
+    // The handlers may already have started a new request
+    startNextRequest();
+}
+
+
+// Polled acquisition: the measurement mnemonic (e.g. "PR1") is queried
+// again as soon as the previous answer arrives, i.e. as fast as the gauge
+// can answer. The answers are handed out as ordinary measurement lines.
+// No continuous transmission is resumed while polling.
+void
+CommunicationModule::startPolling(QByteArray mnemonic) {
+    pollMnemonic = mnemonic;
+    continuousCommand.clear();
+    bTransmissionStopped = false;
+    if(!bPolling)
+        pollNext();
+}
+
+
+void
+CommunicationModule::stopPolling() {
+    pollMnemonic.clear();
+}
+
+
+// bPolling stays true for as long as a poll request (or the
+// retry after a failed one) is pending.
+void
+CommunicationModule::pollNext() {
+    bPolling = !pollMnemonic.isEmpty() && serialPort.isOpen();
+    if(!bPolling)
+        return;
+    sendRequest(pollMnemonic, true, [this](bool bOk, QByteArray reply) {
+        if(!bOk) { // Do not hammer a gauge that does not answer
+            QTimer::singleShot(defaultTimeoutMs, this, [this]() {
+                pollNext();
+            });
+            return;
+        }
+        polledLine.resize(1);
+        polledArrivalNs.resize(1);
+        polledLine[0]      = reply;
+        polledArrivalNs[0] = currentLineNs;
+        emit newLines(polledLine, polledArrivalNs);
+        pollNext();
+    });
+}
@@ -24,7 +24,13 @@
 
 #include <QObject>
 #include <QSerialPort>
-#include <QMutex>
+#include <QTimer>
+#include <QQueue>
+#include <QVector>
+#include <QByteArray>
+#include <functional>
+
+#include "lineframer.h"
 
 
 class CommunicationModule : public QObject
@@ -34,27 +40,79 @@ public:
     explicit CommunicationModule(QObject *parent = nullptr);
     ~CommunicationModule();
 
-public:
-    bool startConnection();
-    bool writeCommand(QString sCommand);
-    QString BlockingQuery(QString queryString);
-    QString Query(QString queryString);
-    QByteArray BinaryQuery(QString queryString);
+    // Called, in the acquisition thread, when a request completes.
+    // bOk is false on <NAK>, on timeout or on a write error.
+    typedef std::function<void(bool bOk, QByteArray reply)> ReplyHandler;
+
+    static const int defaultTimeoutMs = 500;
+
+    struct Request {
+        Request(QByteArray myMnemonic = QByteArray(),
+                bool myEnquire = true,
+                ReplyHandler handler = ReplyHandler(),
+                int myTimeoutMs = defaultTimeoutMs);
+        bool isRead() const;
+        QByteArray mnemonic;
+        bool       bEnquire;
+        int        timeoutMs;
+        QList<ReplyHandler> handlers;
+    };
+
+    void sendRequest(QByteArray mnemonic,
+                     bool bEnquire,
+                     ReplyHandler handler,
+                     int timeoutMs = defaultTimeoutMs);
+    void sendBatch(const QList<Request>& batch);
 
 signals:
     void initialized();
-    void newData(QString sData);
+    void newLines(const QVector<QByteArray>& lines, const QVector<qint64>& arrivalNs);
+    void connectionError(QString sError, QString sDevice);
+    void warning(QString sMessage);
 
 public slots:
+    void setPortParameters(QString sPortName, int baudRate);
+    void setBaudRate(int baudRate);
+    bool startConnection();
+    bool writeCommand(QString sCommand);
+    void startPolling(QByteArray mnemonic);
+    void stopPolling();
     void onNewDataAvailable();
 
+protected slots:
+    void onReplyTimeout();
+
+protected:
+    enum ProtocolState {
+        Idle,
+        WaitingAck,   // Mnemonic sent, waiting for <ACK>/<NAK>
+        WaitingReply  // <ENQ> sent, waiting for the answer string
+    };
+    void enqueueRequest(const Request& request);
+    void startNextRequest();
+    bool processProtocolLine(const QByteArray& line);
+    void completeRequest(bool bOk, QByteArray reply);
+    void pollNext();
+
 protected:
-    QMutex semaphore;
     QString sFilename;
-    QString sCommand;
 
     QSerialPort serialPort;
     QString     serialPortName;
-    QString     receivedData;
-};
+    LineFramer  lineFramer;
+    QVector<QByteArray> lineBatch;
+    QVector<int>        lineBytesAfter;
+    QVector<qint64>     lineArrivalNs;
+    qint64              currentLineNs; // Arrival of the line being processed
 
+    QQueue<Request> requestQueue;
+    Request         currentRequest;
+    ProtocolState   protocolState;
+    QTimer          replyTimer;
+    QByteArray      continuousCommand;     // Last COM sent to the gauge
+    bool            bTransmissionStopped;  // By a request sent after it
+    QByteArray      pollMnemonic;          // Empty when not polling
+    bool            bPolling;
+    QVector<QByteArray> polledLine;
+    QVector<qint64>     polledArrivalNs;
+};
@@ -0,0 +1,591 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include "compressedlog.h"
+#include "textrecord.h"
+#include "pressuresample.h"
+
+#include <QtAlgorithms>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+static const char headerMagic[8] = {'T','P','G','2','6','1','Z','\n'};
+static const char chunkMagic[4]  = {'G','C','K','1'};
+
+
+// Times are encoded in microseconds: the short delta-of-delta buckets
+// cover the jitter of the LF arrival times
+static const double unitsPerSecond = 1.0e6;
+static const int    dodBits[3]     = {10, 14, 20};
+
+
+static inline qint64
+signExtend(quint64 value, int nBits) {
+    return qint64(value << (64-nBits)) >> (64-nBits);
+}
+
+
+static inline bool
+fitsBits(qint64 value, int nBits) {
+    return value >= -(qint64(1) << (nBits-1)) && value < (qint64(1) << (nBits-1));
+}
+
+
+static inline quint64
+doubleBits(double value) {
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+static inline double
+bitsDouble(quint64 bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+BitWriter::BitWriter()
+    : accumulator(0)
+    , nAccumulated(0)
+{
+}
+
+
+void
+BitWriter::clear() {
+    bytes.resize(0);
+    accumulator  = 0;
+    nAccumulated = 0;
+}
+
+
+// Bits are stored most significant first
+void
+BitWriter::write(quint64 bits, int nBits) {
+    if(nBits > 32) {
+        write(bits >> 32, nBits-32);
+        write(bits & 0xffffffffu, 32);
+        return;
+    }
+    accumulator = (accumulator << nBits) | (bits & ((quint64(1) << nBits)-1));
+    nAccumulated += nBits;
+    while(nAccumulated >= 8) {
+        nAccumulated -= 8;
+        bytes.append(char(accumulator >> nAccumulated));
+    }
+    accumulator &= (quint64(1) << nAccumulated)-1;
+}
+
+
+// The bits written so far, the last byte padded with zeroes,
+// without ending the stream
+void
+BitWriter::appendTo(QByteArray& buffer) const {
+    buffer.append(bytes);
+    if(nAccumulated > 0)
+        buffer.append(char(accumulator << (8-nAccumulated)));
+}
+
+
+// Pads the last byte with zeroes
+const QByteArray&
+BitWriter::finish() {
+    if(nAccumulated > 0)
+        bytes.append(char(accumulator << (8-nAccumulated)));
+    accumulator  = 0;
+    nAccumulated = 0;
+    return bytes;
+}
+
+
+BitReader::BitReader(const uchar* pData, int nBytes)
+    : pData(pData)
+    , nBits(qint64(nBytes)*8)
+    , position(0)
+    , bOverrun(false)
+{
+}
+
+
+quint64
+BitReader::read(int nBitsToRead) {
+    quint64 value = 0;
+    while(nBitsToRead > 0) {
+        if(position >= nBits) {
+            bOverrun = true;
+            return 0;
+        }
+        const int available = 8 - int(position & 7);
+        const int taken     = qMin(available, nBitsToRead);
+        const quint64 byte  = pData[position >> 3];
+        value = (value << taken) | ((byte >> (available-taken)) & ((1u << taken)-1));
+        position    += taken;
+        nBitsToRead -= taken;
+    }
+    return value;
+}
+
+
+bool
+BitReader::isOverrun() const {
+    return bOverrun;
+}
+
+
+CompressedLogEncoder::CompressedLogEncoder(int samplesPerChunk)
+    : chunkSamples(samplesPerChunk)
+    , previousUs(0)
+    , previousDelta(0)
+    , previousValue(0)
+    , previousLeading(-1)
+    , previousTrailing(0)
+    , previousStatus(0)
+{
+    std::memset(&chunkHeader, 0, sizeof(chunkHeader));
+    std::memcpy(chunkHeader.magic, chunkMagic, sizeof(chunkMagic));
+}
+
+
+QByteArray
+CompressedLogEncoder::header(const QString& sInfo, qint64 startMsecsSinceEpoch, int samplesPerChunk) {
+    return logFileHeader(headerMagic, sInfo, startMsecsSinceEpoch, samplesPerChunk);
+}
+
+
+void
+CompressedLogEncoder::append(double time, double pressure, int status) {
+    const qint64  us    = qint64(std::llround(time*unitsPerSecond));
+    const quint64 value = doubleBits(pressure);
+    if(chunkHeader.count == 0) {
+        bits.write(quint64(us), 64);
+        bits.write(value, 64);
+        bits.write(quint64(status), 3);
+        previousDelta        = 0;
+        previousLeading      = -1;
+        previousTrailing     = 0;
+        chunkHeader.firstTime   = time;
+        chunkHeader.minPressure = std::numeric_limits<double>::quiet_NaN();
+        chunkHeader.maxPressure = std::numeric_limits<double>::quiet_NaN();
+    }
+    else {
+        // Time: the delta-of-delta is zero for periodic samples
+        const qint64 delta = us - previousUs;
+        const qint64 dod   = delta - previousDelta;
+        if(dod == 0)
+            bits.write(0, 1);
+        else if(fitsBits(dod, dodBits[0])) {
+            bits.write(0x2, 2);
+            bits.write(quint64(dod), dodBits[0]);
+        }
+        else if(fitsBits(dod, dodBits[1])) {
+            bits.write(0x6, 3);
+            bits.write(quint64(dod), dodBits[1]);
+        }
+        else if(fitsBits(dod, dodBits[2])) {
+            bits.write(0xe, 4);
+            bits.write(quint64(dod), dodBits[2]);
+        }
+        else {
+            bits.write(0xf, 4);
+            bits.write(quint64(dod), 64);
+        }
+        previousDelta = delta;
+        // Pressure: only the meaningful bits of the XOR are stored,
+        // reusing the previous window when they fit in it
+        const quint64 xorValue = value ^ previousValue;
+        if(xorValue == 0)
+            bits.write(0, 1);
+        else {
+            const int leading  = qMin(31, int(qCountLeadingZeroBits(xorValue)));
+            const int trailing = int(qCountTrailingZeroBits(xorValue));
+            if(previousLeading >= 0 && leading >= previousLeading && trailing >= previousTrailing) {
+                bits.write(0x2, 2);
+                bits.write(xorValue >> previousTrailing, 64-previousLeading-previousTrailing);
+            }
+            else {
+                const int meaningful = 64 - leading - trailing;
+                bits.write(0x3, 2);
+                bits.write(quint64(leading), 5);
+                bits.write(quint64(meaningful-1), 6);
+                bits.write(xorValue >> trailing, meaningful);
+                previousLeading  = leading;
+                previousTrailing = trailing;
+            }
+        }
+        // Status: a single bit while it does not change
+        if(status == previousStatus)
+            bits.write(0, 1);
+        else {
+            bits.write(1, 1);
+            bits.write(quint64(status), 3);
+        }
+    }
+    previousUs     = us;
+    previousValue  = value;
+    previousStatus = status;
+    chunkHeader.lastTime = time;
+    if(status <= PressureSample::Overrange) {
+        if(!(pressure >= chunkHeader.minPressure))
+            chunkHeader.minPressure = pressure;
+        if(!(pressure <= chunkHeader.maxPressure))
+            chunkHeader.maxPressure = pressure;
+    }
+    chunkHeader.count++;
+}
+
+
+int
+CompressedLogEncoder::pendingSamples() const {
+    return int(chunkHeader.count);
+}
+
+
+bool
+CompressedLogEncoder::isChunkFull() const {
+    return int(chunkHeader.count) >= chunkSamples;
+}
+
+
+// The returned buffer is valid until the next call
+const QByteArray&
+CompressedLogEncoder::finishChunk() {
+    const QByteArray& payload = bits.finish();
+    chunkHeader.nBytes = quint32(payload.size());
+    chunkBuffer.resize(0);
+    chunkBuffer.append(reinterpret_cast<const char*>(&chunkHeader), sizeof(chunkHeader));
+    chunkBuffer.append(payload.constData(), payload.size());
+    bits.clear();
+    chunkHeader.count = 0;
+    return chunkBuffer;
+}
+
+
+// The pending samples as a complete chunk, that is kept open
+// for the next samples (see OutputWriter::setTail()).
+// The returned buffer is valid until the next call.
+const QByteArray&
+CompressedLogEncoder::peekChunk() {
+    chunkBuffer.resize(sizeof(chunkHeader));
+    bits.appendTo(chunkBuffer);
+    CompressedChunkHeader header = chunkHeader;
+    header.nBytes = quint32(chunkBuffer.size() - int(sizeof(header)));
+    std::memcpy(chunkBuffer.data(), &header, sizeof(header));
+    return chunkBuffer;
+}
+
+
+static bool
+decodeSamples(const uchar* pData, int nBytes, int count, QVector<double>& times,
+              QVector<double>& pressures, QVector<quint8>& statuses)
+{
+    BitReader reader(pData, nBytes);
+    qint64  us       = 0;
+    qint64  delta    = 0;
+    quint64 value    = 0;
+    int     leading  = 0;
+    int     trailing = 0;
+    int     status   = 0;
+    for(int i=0; i<count; i++) {
+        if(i == 0) {
+            us     = qint64(reader.read(64));
+            value  = reader.read(64);
+            status = int(reader.read(3));
+        }
+        else {
+            qint64 dod = 0;
+            if(reader.read(1)) {
+                if(!reader.read(1))
+                    dod = signExtend(reader.read(dodBits[0]), dodBits[0]);
+                else if(!reader.read(1))
+                    dod = signExtend(reader.read(dodBits[1]), dodBits[1]);
+                else if(!reader.read(1))
+                    dod = signExtend(reader.read(dodBits[2]), dodBits[2]);
+                else
+                    dod = qint64(reader.read(64));
+            }
+            delta += dod;
+            us    += delta;
+            if(reader.read(1)) {
+                if(reader.read(1)) {
+                    leading  = int(reader.read(5));
+                    trailing = 64 - leading - (int(reader.read(6))+1);
+                }
+                value ^= reader.read(64-leading-trailing) << trailing;
+            }
+            if(reader.read(1))
+                status = int(reader.read(3));
+        }
+        if(reader.isOverrun())
+            return false;
+        times.append(double(us)/unitsPerSecond);
+        pressures.append(bitsDouble(value));
+        statuses.append(quint8(status));
+    }
+    return true;
+}
+
+
+CompressedLogReader::CompressedLogReader()
+    : pMap(nullptr)
+    , pHeader(nullptr)
+    , nSamples(0)
+{
+}
+
+
+CompressedLogReader::~CompressedLogReader() {
+    close();
+}
+
+
+bool
+CompressedLogReader::isCompressedLog(QString sFileName) {
+    QFile inFile(sFileName);
+    if(!inFile.open(QIODevice::ReadOnly))
+        return false;
+    return inFile.read(sizeof(headerMagic)) == QByteArray(headerMagic, sizeof(headerMagic));
+}
+
+
+// Only the chunk headers are read to build the index
+bool
+CompressedLogReader::open(QString sFileName) {
+    close();
+    file.setFileName(sFileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        sError = file.errorString();
+        return false;
+    }
+    const qint64 fileSize = file.size();
+    pMap = fileSize > 0 ? file.map(0, fileSize) : nullptr;
+    if(!pMap) {
+        sError = fileSize > 0 ? file.errorString() : QString("Empty file");
+        close();
+        return false;
+    }
+    pHeader = checkLogHeader(pMap, fileSize, headerMagic, sError);
+    if(!pHeader) {
+        close();
+        return false;
+    }
+    qint64 offset = pHeader->size;
+    while(offset+qint64(sizeof(CompressedChunkHeader)) <= fileSize) {
+        CompressedChunkHeader chunkHeader;
+        std::memcpy(&chunkHeader, pMap+offset, sizeof(chunkHeader));
+        if(std::memcmp(chunkHeader.magic, chunkMagic, sizeof(chunkMagic)))
+            break;
+        if(offset+qint64(sizeof(chunkHeader))+chunkHeader.nBytes > fileSize)
+            break; // Truncated by a crash: keep what precedes it
+        Chunk chunk;
+        chunk.offset      = offset;
+        chunk.count       = int(chunkHeader.count);
+        chunk.firstTime   = chunkHeader.firstTime;
+        chunk.lastTime    = chunkHeader.lastTime;
+        chunk.minPressure = chunkHeader.minPressure;
+        chunk.maxPressure = chunkHeader.maxPressure;
+        chunks.append(chunk);
+        nSamples += chunk.count;
+        offset   += qint64(sizeof(chunkHeader)) + chunkHeader.nBytes;
+    }
+    return true;
+}
+
+
+void
+CompressedLogReader::close() {
+    chunks.clear();
+    nSamples = 0;
+    pHeader  = nullptr;
+    if(pMap)
+        file.unmap(pMap);
+    pMap = nullptr;
+    if(file.isOpen())
+        file.close();
+}
+
+
+QString
+CompressedLogReader::errorString() const {
+    return sError;
+}
+
+
+QString
+CompressedLogReader::info() const {
+    if(!pHeader)
+        return QString();
+    return QString::fromUtf8(pHeader->info, int(pHeader->infoLength));
+}
+
+
+qint64
+CompressedLogReader::startMsecsSinceEpoch() const {
+    return pHeader ? pHeader->startMsecsSinceEpoch : 0;
+}
+
+
+qint64
+CompressedLogReader::sampleCount() const {
+    return nSamples;
+}
+
+
+int
+CompressedLogReader::chunkCount() const {
+    return chunks.count();
+}
+
+
+const CompressedLogReader::Chunk&
+CompressedLogReader::chunk(int i) const {
+    return chunks.at(i);
+}
+
+
+// Appends the decoded samples of chunk i
+bool
+CompressedLogReader::decodeChunk(int i, QVector<double>& times,
+                                 QVector<double>& pressures, QVector<quint8>& statuses) const
+{
+    const Chunk& chunk = chunks.at(i);
+    CompressedChunkHeader chunkHeader;
+    std::memcpy(&chunkHeader, pMap+chunk.offset, sizeof(chunkHeader));
+    return decodeSamples(pMap+chunk.offset+sizeof(chunkHeader), int(chunkHeader.nBytes),
+                         chunk.count, times, pressures, statuses);
+}
+
+
+// Appends the samples with fromTime <= time <= toTime:
+// only the chunks overlapping the range are decoded.
+bool
+CompressedLogReader::decodeRange(double fromTime, double toTime, QVector<double>& times,
+                                 QVector<double>& pressures, QVector<quint8>& statuses) const
+{
+    QVector<double> chunkTimes, chunkPressures;
+    QVector<quint8> chunkStatuses;
+    auto first = std::lower_bound(chunks.constBegin(), chunks.constEnd(), fromTime,
+                                  [](const Chunk& chunk, double time) {
+                                      return chunk.lastTime < time;
+                                  });
+    for(auto it=first; it!=chunks.constEnd() && it->firstTime<=toTime; ++it) {
+        chunkTimes.resize(0);
+        chunkPressures.resize(0);
+        chunkStatuses.resize(0);
+        if(!decodeChunk(int(it-chunks.constBegin()), chunkTimes, chunkPressures, chunkStatuses))
+            return false;
+        for(int i=0; i<chunkTimes.count(); i++) {
+            if(chunkTimes.at(i) < fromTime || chunkTimes.at(i) > toTime)
+                continue;
+            times.append(chunkTimes.at(i));
+            pressures.append(chunkPressures.at(i));
+            statuses.append(chunkStatuses.at(i));
+        }
+    }
+    return true;
+}
+
+
+bool
+convertTextToCompressed(QString sTextFile, QString sCompressedFile, QString& sError) {
+    TextLogReader reader;
+    if(!reader.open(sTextFile)) {
+        sError = QString("%1: %2").arg(sTextFile, reader.errorString());
+        return false;
+    }
+    QFile outFile(sCompressedFile);
+    if(!outFile.open(QIODevice::WriteOnly)) {
+        sError = QString("%1: %2").arg(sCompressedFile, outFile.errorString());
+        return false;
+    }
+    CompressedLogEncoder encoder;
+    double time, pressure;
+    // The header is complete once the first record has been read
+    bool bRecord = reader.next(time, pressure);
+    outFile.write(CompressedLogEncoder::header(reader.infoLines().join('\n'),
+                                               reader.startMsecsSinceEpoch()));
+    while(bRecord) {
+        encoder.append(time, pressure, PressureSample::MeasurementOk);
+        if(encoder.isChunkFull())
+            outFile.write(encoder.finishChunk());
+        bRecord = reader.next(time, pressure);
+    }
+    if(encoder.pendingSamples() > 0)
+        outFile.write(encoder.finishChunk());
+    if(outFile.error() != QFileDevice::NoError) {
+        sError = QString("%1: %2").arg(sCompressedFile, outFile.errorString());
+        return false;
+    }
+    return true;
+}
+
+
+// Samples without a valid pressure are not written,
+// as in the text files written during the acquisition.
+bool
+convertCompressedToText(QString sCompressedFile, QString sTextFile, QString& sError) {
+    CompressedLogReader reader;
+    if(!reader.open(sCompressedFile)) {
+        sError = QString("%1: %2").arg(sCompressedFile, reader.errorString());
+        return false;
+    }
+    QFile outFile(sTextFile);
+    if(!outFile.open(QIODevice::WriteOnly|QIODevice::Text)) {
+        sError = QString("%1: %2").arg(sTextFile, outFile.errorString());
+        return false;
+    }
+    QStringList infoLines;
+    if(!reader.info().isEmpty())
+        infoLines = reader.info().split('\n');
+    outFile.write(TextRecordEncoder::header(infoLines));
+    TextRecordEncoder encoder;
+    QVector<double> times, pressures;
+    QVector<quint8> statuses;
+    for(int iChunk=0; iChunk<reader.chunkCount(); iChunk++) {
+        times.resize(0);
+        pressures.resize(0);
+        statuses.resize(0);
+        if(!reader.decodeChunk(iChunk, times, pressures, statuses)) {
+            sError = QString("%1: corrupted chunk %2").arg(sCompressedFile).arg(iChunk);
+            return false;
+        }
+        for(int i=0; i<times.count(); i++) {
+            if(statuses.at(i) > PressureSample::Overrange)
+                continue;
+            encoder.append(times.at(i), pressures.at(i));
+        }
+        outFile.write(encoder.data(), encoder.size());
+        encoder.clear();
+    }
+    if(outFile.error() != QFileDevice::NoError) {
+        sError = QString("%1: %2").arg(sTextFile, outFile.errorString());
+        return false;
+    }
+    return true;
+}
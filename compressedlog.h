@@ -0,0 +1,155 @@
+// MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include "binarylog.h"
+
+
+// Compressed long term storage (after the Gorilla time series
+// compression of Pelkonen et al., VLDB 2015):
+//    a BinaryLogHeader ("TPG261Z\n") followed by independently
+//    decodable chunks. Each chunk is a CompressedChunkHeader,
+//    that works as the chunk index, and a bit stream where every
+//    sample is encoded as
+//      - the delta-of-delta of its time in microseconds,
+//      - the XOR of its pressure with the previous one,
+//      - its gauge status, only when it changes.
+// Pressures and status codes are kept exactly; times are rounded to
+// the microsecond.
+struct CompressedChunkHeader
+{
+    char    magic[4];     // "GCK1"
+    quint32 count;        // Samples in the chunk
+    quint32 nBytes;       // Length of the bit stream that follows
+    quint32 reserved;
+    double  firstTime;    // [s]
+    double  lastTime;     // [s]
+    double  minPressure;  // Of the samples with a valid pressure
+    double  maxPressure;  // (NaN if there are none)
+};
+
+
+class BitWriter
+{
+public:
+    BitWriter();
+    void clear();
+    void write(quint64 bits, int nBits);
+    void appendTo(QByteArray& buffer) const;
+    const QByteArray& finish();
+
+protected:
+    QByteArray bytes;
+    quint64    accumulator;
+    int        nAccumulated;
+};
+
+
+class BitReader
+{
+public:
+    BitReader(const uchar* pData, int nBytes);
+    quint64 read(int nBits);
+    bool isOverrun() const;
+
+protected:
+    const uchar* pData;
+    qint64       nBits;
+    qint64       position;
+    bool         bOverrun;
+};
+
+
+class CompressedLogEncoder
+{
+public:
+    static const int defaultChunkSamples = 4096;
+
+    explicit CompressedLogEncoder(int samplesPerChunk = defaultChunkSamples);
+    static QByteArray header(const QString& sInfo, qint64 startMsecsSinceEpoch,
+                             int samplesPerChunk = defaultChunkSamples);
+    void append(double time, double pressure, int status);
+    int  pendingSamples() const;
+    bool isChunkFull() const;
+    const QByteArray& finishChunk();
+    const QByteArray& peekChunk();
+
+protected:
+    int        chunkSamples;
+    BitWriter  bits;
+    QByteArray chunkBuffer;
+    CompressedChunkHeader chunkHeader;
+    qint64     previousUs;
+    qint64     previousDelta;
+    quint64    previousValue;
+    int        previousLeading;
+    int        previousTrailing;
+    int        previousStatus;
+};
+
+
+class CompressedLogReader
+{
+public:
+    struct Chunk {
+        qint64 offset;    // Of the CompressedChunkHeader
+        int    count;
+        double firstTime;
+        double lastTime;
+        double minPressure;
+        double maxPressure;
+    };
+
+    CompressedLogReader();
+    ~CompressedLogReader();
+    static bool isCompressedLog(QString sFileName);
+    bool open(QString sFileName);
+    void close();
+    QString errorString() const;
+    QString info() const;
+    qint64 startMsecsSinceEpoch() const;
+    qint64 sampleCount() const;
+    int chunkCount() const;
+    const Chunk& chunk(int i) const;
+    bool decodeChunk(int i, QVector<double>& times,
+                     QVector<double>& pressures, QVector<quint8>& statuses) const;
+    bool decodeRange(double fromTime, double toTime, QVector<double>& times,
+                     QVector<double>& pressures, QVector<quint8>& statuses) const;
+
+protected:
+    QFile          file;
+    uchar*         pMap;
+    const BinaryLogHeader* pHeader;
+    QVector<Chunk> chunks;
+    qint64         nSamples;
+    QString        sError;
+};
+
+
+bool convertTextToCompressed(QString sTextFile, QString sCompressedFile, QString& sError);
+bool convertCompressedToText(QString sCompressedFile, QString sTextFile, QString& sError);
@@ -18,8 +18,230 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "datastream2d.h"
 #include <float.h>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+
+
+SlidingExtremum::SlidingExtremum(bool bMaximum)
+    : bMaximum(bMaximum)
+{
+}
+
+
+void
+SlidingExtremum::clear() {
+    entries.clear();
+}
+
+
+// Values that can no more be the extremum are dropped
+void
+SlidingExtremum::push(qint64 index, double value) {
+    while(!entries.empty() &&
+          (bMaximum ? entries.back().second <= value : entries.back().second >= value))
+        entries.pop_back();
+    entries.push_back(qMakePair(index, value));
+}
+
+
+void
+SlidingExtremum::evictBefore(qint64 firstIndex) {
+    while(!entries.empty() && entries.front().first < firstIndex)
+        entries.pop_front();
+}
+
+
+double
+SlidingExtremum::value() const {
+    return entries.front().second;
+}
+
+
+LodPyramid::LodPyramid(int bucketSamples, int levelCapacity)
+    : bucketSamples(qMax(1, bucketSamples))
+    , levelCapacity(qMax(2, levelCapacity))
+{
+    clear();
+}
+
+
+void
+LodPyramid::clear() {
+    levels.clear();
+    nSamples = 0;
+}
+
+
+bool
+LodPyramid::isEmpty() const {
+    return nSamples == 0;
+}
+
+
+qint64
+LodPyramid::sampleCount() const {
+    return nSamples;
+}
+
+
+// Overall extremes of all the samples ever appended
+LodBucket
+LodPyramid::limits() const {
+    return total;
+}
+
+
+void
+LodPyramid::merge(LodBucket& bucket, const LodBucket& next) {
+    bucket.xLast = next.xLast;
+    bucket.yLast = next.yLast;
+    bucket.yMin  = qMin(bucket.yMin, next.yMin);
+    bucket.yMax  = qMax(bucket.yMax, next.yMax);
+}
+
+
+void
+LodPyramid::append(double x, double y) {
+    const LodBucket sample = {x, x, y, y, y, y};
+    if(nSamples == 0)
+        total = sample;
+    else
+        merge(total, sample);
+    total.xFirst = qMin(total.xFirst, x);
+    total.xLast  = qMax(total.xLast, x);
+    nSamples++;
+    feed(0, sample);
+}
+
+
+// A completed bucket is stored in its level and goes on
+// filling the pending bucket of the level above.
+void
+LodPyramid::feed(int level, const LodBucket& bucket) {
+    if(level == levels.count()) {
+        Level newLevel;
+        newLevel.nPending   = 0;
+        newLevel.bTruncated = false;
+        levels.append(newLevel);
+    }
+    Level& current = levels[level];
+    if(current.nPending == 0)
+        current.pending = bucket;
+    else
+        merge(current.pending, bucket);
+    current.nPending++;
+    if(current.nPending < (level == 0 ? bucketSamples : 2))
+        return;
+    const LodBucket completed = current.pending;
+    current.nPending = 0;
+    current.buckets.push_back(completed);
+    if(int(current.buckets.size()) > levelCapacity) {
+        current.buckets.pop_front();
+        current.bTruncated = true;
+    }
+    feed(level+1, completed);
+}
+
+
+// Selects the finest level that still reaches back to xFrom with no more
+// than maxBuckets buckets in [xFrom, xTo]. The pending buckets of that
+// level and of the finer ones are added at the end: they hold the most
+// recent samples, not yet merged in a complete bucket.
+void
+LodPyramid::select(double xFrom, double xTo, int maxBuckets, QVector<LodBucket>& selected) const {
+    selected.clear();
+    if(levels.isEmpty())
+        return;
+    int level = 0;
+    std::deque<LodBucket>::const_iterator first, last;
+    for(; level<levels.count(); level++) {
+        const std::deque<LodBucket>& buckets = levels.at(level).buckets;
+        if(levels.at(level).bTruncated && buckets.front().xFirst > xFrom)
+            continue;
+        first = std::lower_bound(buckets.begin(), buckets.end(), xFrom,
+                                 [](const LodBucket& b, double x) { return b.xLast < x; });
+        last  = std::upper_bound(first, buckets.end(), xTo,
+                                 [](double x, const LodBucket& b) { return x < b.xFirst; });
+        if(last-first+level+1 <= maxBuckets || level == levels.count()-1)
+            break;
+    }
+    if(level == levels.count())
+        return;
+    selected.reserve(int(last-first)+level+1);
+    for(; first!=last; ++first)
+        selected.append(*first);
+    for(int i=level; i>=0; i--) {
+        const Level& current = levels.at(i);
+        if(current.nPending > 0 &&
+           current.pending.xLast >= xFrom &&
+           current.pending.xFirst <= xTo)
+            selected.append(current.pending);
+    }
+}
+
+
+DataSnapshot::DataSnapshot()
+    : minx(0.0)
+    , maxx(0.0)
+    , miny(0.0)
+    , maxy(0.0)
+    , offset(0)
+    , nPoints(0)
+    , bSorted(true)
+{
+}
+
+
+int
+DataSnapshot::count() const {
+    return nPoints;
+}
+
+
+// Two binary searches when x is non decreasing,
+// the whole window otherwise.
+void
+DataSnapshot::range(double xFrom, double xTo, int& first, int& last) const {
+    first = 0;
+    last  = nPoints;
+    if(!bSorted)
+        return;
+    int lo = 0, hi = nPoints;
+    while(lo < hi) {
+        const int mid = (lo+hi)/2;
+        if(x(mid) < xFrom) lo = mid+1;
+        else               hi = mid;
+    }
+    first = lo;
+    hi = nPoints;
+    while(lo < hi) {
+        const int mid = (lo+hi)/2;
+        if(x(mid) <= xTo) lo = mid+1;
+        else              hi = mid;
+    }
+    last = lo;
+    if(first > 0)
+        first--;
+    if(last < nPoints)
+        last++;
+}
+
+
+int
+DataSnapshot::span(int i, int last, const DataChunk*& pChunk, int& slot) const {
+    i += offset;
+    pChunk = chunks.at(i >> DataChunk::shift).get();
+    slot   = i & (DataChunk::size-1);
+    return qMin(last+offset-i, DataChunk::size-slot);
+}
+
 
 DataStream2D::DataStream2D(int Id, int PenWidth, QColor Color, int Symbol, QString Title)
+    : minX(false)
+    , maxX(true)
+    , minY(false)
+    , maxY(true)
 {
     Properties.SetId(Id);
     Properties.Color    = Color;
@@ -31,17 +253,24 @@ DataStream2D::DataStream2D(int Id, int PenWidth, QColor Color, int Symbol, QStri
         Properties.Title = QString("Data Set %2").arg(Properties.GetId());
     isShown         = false;
     bShowCurveTitle = false;
-    maxPoints = 100;
+    clearWindow();
+    setMaxPoints(100);
 }
 
 
-DataStream2D::DataStream2D(DataSetProperties myProperties) {
+DataStream2D::DataStream2D(DataSetProperties myProperties)
+    : minX(false)
+    , maxX(true)
+    , minY(false)
+    , maxY(true)
+{
     Properties = myProperties;
     if(myProperties.Title == QString())
         Properties.Title = QString("Data Set %1").arg(Properties.GetId());
     isShown         = false;
     bShowCurveTitle = false;
-    maxPoints = 100;
+    clearWindow();
+    setMaxPoints(100);
 }
 
 
@@ -55,36 +284,223 @@ DataStream2D::SetShow(bool show) {
 }
 
 
+double&
+DataStream2D::xAt(int i) {
+    i += offset;
+    return chunks[i >> DataChunk::shift]->x[i & (DataChunk::size-1)];
+}
+
+
+double&
+DataStream2D::yAt(int i) {
+    i += offset;
+    return chunks[i >> DataChunk::shift]->y[i & (DataChunk::size-1)];
+}
+
+
+// Visible to the drawing after the next publish()
 void
 DataStream2D::AddPoint(double x, double y) {
-    m_pointArrayX.append(x);
-    m_pointArrayY.append(y);
-    if(m_pointArrayX.count() == 1) {
-        minx = x-DBL_MIN;
-        maxx = x+DBL_MIN;
-        miny = y-DBL_MIN;
-        maxy = y+DBL_MIN;
+    append(x, y);
+}
+
+
+// Bulk version of AddPoint(): points with a NaN y are skipped
+// and a single snapshot is published.
+void
+DataStream2D::AddPoints(const double* pointsX, const double* pointsY, int nNewPoints) {
+    for(int i=0; i<nNewPoints; i++) {
+        if(!std::isnan(pointsY[i]))
+            append(pointsX[i], pointsY[i]);
     }
-    if(m_pointArrayX.count() > maxPoints) {
-        m_pointArrayX.remove(0, maxPoints/4);
-        m_pointArrayY.remove(0, maxPoints/4);
-        minx = x-DBL_MIN;
-        maxx = x+DBL_MIN;
-        miny = y-DBL_MIN;
-        maxy = y+DBL_MIN;
-        for(int i=0; i<m_pointArrayX.count(); i++) {
-            if(m_pointArrayX.at(i) < minx) minx = m_pointArrayX.at(i);
-            if(m_pointArrayX.at(i) > maxx) maxx = m_pointArrayX.at(i);
-            if(m_pointArrayY.at(i) < miny) miny = m_pointArrayY.at(i);
-            if(m_pointArrayY.at(i) > maxy) maxy = m_pointArrayY.at(i);
+    publish();
+}
+
+
+// O(1): when full, the oldest point leaves the window for the
+// history. The slots are never rewritten: a new chunk is started
+// when the last one is full and the first one is dropped once empty.
+void
+DataStream2D::append(double x, double y) {
+    if(nPoints == maxPoints) {
+        if(nPoints > 1 && xAt(1) < xAt(0))
+            nDescents--;
+        evict(xAt(0), yAt(0));
+        nPoints--;
+        offset++;
+        if(offset == DataChunk::size) {
+            chunks.removeFirst();
+            offset = 0;
         }
     }
-    else {
-        minx = minx < x ? minx : x-DBL_MIN;
-        maxx = maxx > x ? maxx : x+DBL_MIN;
-        miny = miny < y ? miny : y-DBL_MIN;
-        maxy = maxy > y ? maxy : y+DBL_MIN;
+    if(nPoints > 0 && x < xAt(nPoints-1))
+        nDescents++;
+    if(offset+nPoints == chunks.count()*DataChunk::size)
+        chunks.append(std::shared_ptr<DataChunk>(new DataChunk));
+    xAt(nPoints) = x;
+    yAt(nPoints) = y;
+    const int j = offset+nPoints;
+    chunks[j >> DataChunk::shift]->logX[j & (DataChunk::size-1)] = std::log10(x);
+    chunks[j >> DataChunk::shift]->logY[j & (DataChunk::size-1)] = std::log10(y);
+    nPoints++;
+    minX.push(nAdded, x);
+    maxX.push(nAdded, x);
+    minY.push(nAdded, y);
+    maxY.push(nAdded, y);
+    nAdded++;
+    const qint64 first = nAdded - nPoints;
+    minX.evictBefore(first);
+    maxX.evictBefore(first);
+    minY.evictBefore(first);
+    maxY.evictBefore(first);
+    bChanged = true;
+}
+
+
+// The evicted points go to the history and a new snapshot of
+// the window (sharing the chunks) replaces the published one.
+// Nothing is done if no point has been added or removed.
+void
+DataStream2D::publish() {
+    flushHistory();
+    if(!bChanged)
+        return;
+    bChanged = false;
+    std::shared_ptr<DataSnapshot> pSnapshot(new DataSnapshot());
+    pSnapshot->chunks.reserve(chunks.count());
+    for(int i=0; i<chunks.count(); i++)
+        pSnapshot->chunks.append(chunks.at(i));
+    pSnapshot->offset  = offset;
+    pSnapshot->nPoints = nPoints;
+    pSnapshot->bSorted = nDescents == 0;
+    if(nPoints > 0) {
+        pSnapshot->minx = minX.value();
+        pSnapshot->maxx = maxX.value();
+        pSnapshot->miny = minY.value();
+        pSnapshot->maxy = maxY.value();
+        // Only this thread changes the pyramid: no lock to read it
+        if(!pyramid.isEmpty()) {
+            const LodBucket history = pyramid.limits();
+            pSnapshot->minx = qMin(pSnapshot->minx, history.xFirst);
+            pSnapshot->maxx = qMax(pSnapshot->maxx, history.xLast);
+            pSnapshot->miny = qMin(pSnapshot->miny, history.yMin);
+            pSnapshot->maxy = qMax(pSnapshot->maxy, history.yMax);
+        }
+        pSnapshot->minx -= DBL_MIN;
+        pSnapshot->maxx += DBL_MIN;
+        pSnapshot->miny -= DBL_MIN;
+        pSnapshot->maxy += DBL_MIN;
+    }
+    std::atomic_store(&published, std::shared_ptr<const DataSnapshot>(pSnapshot));
+}
+
+
+std::shared_ptr<const DataSnapshot>
+DataStream2D::snapshot() const {
+    return std::atomic_load(&published);
+}
+
+
+// Limits of the y values with x in [xFrom, xTo], history included
+bool
+DataStream2D::yLimits(const DataSnapshot& window, double xFrom, double xTo, double& yMin, double& yMax) const {
+    bool bFound = false;
+    int first, last;
+    window.range(xFrom, xTo, first, last);
+    for(int i=first; i<last; i++) {
+        const double x = window.x(i);
+        const double y = window.y(i);
+        if(x < xFrom || x > xTo)
+            continue;
+        if(!bFound || y < yMin) yMin = y;
+        if(!bFound || y > yMax) yMax = y;
+        bFound = true;
+    }
+    QVector<LodBucket> buckets;
+    selectHistory(xFrom, xTo, 4096, buckets);
+    for(int i=0; i<buckets.count(); i++) {
+        if(!bFound || buckets.at(i).yMin < yMin) yMin = buckets.at(i).yMin;
+        if(!bFound || buckets.at(i).yMax > yMax) yMax = buckets.at(i).yMax;
+        bFound = true;
     }
+    return bFound;
+}
+
+
+bool
+DataStream2D::hasHistory() const {
+    QMutexLocker locker(&historyMutex);
+    return !pyramid.isEmpty();
+}
+
+
+void
+DataStream2D::selectHistory(double xFrom, double xTo, int maxBuckets, QVector<LodBucket>& buckets) const {
+    QMutexLocker locker(&historyMutex);
+    pyramid.select(xFrom, xTo, maxBuckets, buckets);
+}
+
+
+qint64
+DataStream2D::historyCount(double xFrom, double xTo) const {
+    QMutexLocker locker(&historyMutex);
+    return store.count(xFrom, xTo);
+}
+
+
+// No disk access: false if some of the samples are not in memory
+bool
+DataStream2D::readHistory(double xFrom, double xTo, QVector<double>& x, QVector<double>& y) {
+    QMutexLocker locker(&historyMutex);
+    return store.read(xFrom, xTo, x, y);
+}
+
+
+// Reads back from the disk the samples of [xFrom, xTo] for the next
+// readHistory(). The lock is not held during the reads, so this can
+// run in a worker thread while the points go on being added.
+bool
+DataStream2D::loadHistory(double xFrom, double xTo) {
+    QVector<SampleStore::PageLoad> loads;
+    QString sFileName;
+    {
+        QMutexLocker locker(&historyMutex);
+        loads     = store.pagesToLoad(xFrom, xTo);
+        sFileName = store.fileName();
+    }
+    if(loads.isEmpty())
+        return true;
+    QString sError;
+    if(!SampleStore::loadPages(sFileName, loads, sError))
+        return false;
+    QMutexLocker locker(&historyMutex);
+    store.install(loads);
+    return true;
+}
+
+
+// The evicted points go to the history in groups,
+// so that the pending ones stay few even in AddPoints()
+void
+DataStream2D::evict(double x, double y) {
+    evictedX.append(x);
+    evictedY.append(y);
+    if(evictedX.count() >= DataChunk::size)
+        flushHistory();
+}
+
+
+void
+DataStream2D::flushHistory() {
+    if(evictedX.isEmpty())
+        return;
+    QMutexLocker locker(&historyMutex);
+    for(int i=0; i<evictedX.count(); i++) {
+        pyramid.append(evictedX.at(i), evictedY.at(i));
+        store.append(evictedX.at(i), evictedY.at(i));
+    }
+    evictedX.clear();
+    evictedY.clear();
 }
 
 
@@ -102,8 +518,31 @@ DataStream2D::GetId() {
 
 void
 DataStream2D::RemoveAllPoints() {
-    m_pointArrayX.clear();
-    m_pointArrayY.clear();
+    clearWindow();
+    evictedX.clear();
+    evictedY.clear();
+    {
+        QMutexLocker locker(&historyMutex);
+        pyramid.clear();
+        store.clear();
+    }
+    publish();
+}
+
+
+// The published snapshots keep their chunks
+void
+DataStream2D::clearWindow() {
+    chunks.clear();
+    offset    = 0;
+    nAdded    = 0;
+    nPoints   = 0;
+    nDescents = 0;
+    bChanged  = true;
+    minX.clear();
+    maxX.clear();
+    minY.clear();
+    maxY.clear();
 }
 
 
@@ -138,9 +577,24 @@ DataStream2D::GetTitle() {
 }
 
 
+// The most recent points are kept,
+// the ones that no longer fit go to the history
 void
-DataStream2D::setMaxPoints(int nPoints) {
-    maxPoints = nPoints;
+DataStream2D::setMaxPoints(int newMaxPoints) {
+    newMaxPoints = qMax(1, newMaxPoints);
+    const int nKept = qMin(newMaxPoints, nPoints);
+    for(int i=0; i<nPoints-nKept; i++)
+        evict(xAt(i), yAt(i));
+    QVector<double> keptX(nKept), keptY(nKept);
+    for(int i=0; i<nKept; i++) {
+        keptX[i] = xAt(nPoints-nKept+i);
+        keptY[i] = yAt(nPoints-nKept+i);
+    }
+    maxPoints = newMaxPoints;
+    clearWindow();
+    for(int i=0; i<nKept; i++)
+        append(keptX.at(i), keptY.at(i));
+    publish();
 }
 
 
@@ -149,3 +603,17 @@ DataStream2D::getMaxPoints() {
     return maxPoints;
 }
 
+
+// A quarter of the budget goes to the window (each point takes
+// 4 doubles: x, y and their log10), the rest to the sample store
+void
+DataStream2D::setMemoryBudget(qint64 nBytes) {
+    const qint64 windowBytes = nBytes/4;
+    const int newMaxPoints = int(qBound(qint64(16),
+                                        windowBytes/qint64(4*sizeof(double)),
+                                        qint64(INT_MAX/2)));
+    if(newMaxPoints != maxPoints)
+        setMaxPoints(newMaxPoints);
+    QMutexLocker locker(&historyMutex);
+    store.setMemoryBudget(nBytes-windowBytes);
+}
@@ -20,9 +20,164 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QVector>
 #include <QColor>
+#include <QPair>
+#include <QMutex>
+#include <deque>
+#include <memory>
 
 #include "DataSetProperties.h"
+#include "samplestore.h"
 
+
+// Extremum of the values in a sliding window (monotonic deque):
+// amortized O(1) for each new value and each eviction.
+class SlidingExtremum
+{
+public:
+    explicit SlidingExtremum(bool bMaximum);
+    void clear();
+    void push(qint64 index, double value);
+    void evictBefore(qint64 firstIndex);
+    double value() const;
+
+protected:
+    bool bMaximum;
+    std::deque<QPair<qint64, double>> entries;
+};
+
+
+// Aggregate of consecutive samples
+struct LodBucket
+{
+    double xFirst;
+    double xLast;
+    double yFirst;
+    double yLast;
+    double yMin;
+    double yMax;
+};
+
+
+// Level-of-detail pyramid of min/max/first/last aggregates.
+// Level 0 buckets aggregate bucketSamples samples and every further
+// level merges pairs of buckets of the level below. Each level keeps
+// only its most recent levelCapacity buckets, so the memory grows with
+// the logarithm of the number of samples. The x values are assumed
+// to be non decreasing (time series).
+class LodPyramid
+{
+public:
+    explicit LodPyramid(int bucketSamples=16, int levelCapacity=4096);
+    void clear();
+    void append(double x, double y);
+    bool isEmpty() const;
+    qint64 sampleCount() const;
+    LodBucket limits() const;
+    void select(double xFrom, double xTo, int maxBuckets, QVector<LodBucket>& selected) const;
+
+protected:
+    struct Level {
+        std::deque<LodBucket> buckets;
+        LodBucket pending;   // The bucket still being filled
+        int  nPending;
+        bool bTruncated;     // The oldest buckets have been dropped
+    };
+    static void merge(LodBucket& bucket, const LodBucket& next);
+    void feed(int level, const LodBucket& bucket);
+
+protected:
+    int bucketSamples;
+    int levelCapacity;
+    QVector<Level> levels;
+    qint64 nSamples;
+    LodBucket total;
+};
+
+
+// Storage of the points of a DataStream2D. Each slot of a chunk is
+// written only once, so the chunks are shared by the snapshots.
+// The log10 of the coordinates are computed once, when the point is
+// added: with logarithmic axes the plots only scale and translate them.
+struct DataChunk
+{
+    static const int shift = 10;
+    static const int size  = 1 << shift;
+    double x[size];
+    double y[size];
+    double logX[size];
+    double logY[size];
+};
+
+
+// Immutable view of the points window of a DataStream2D: it does not
+// change, and stays valid, while new points go on being added.
+class DataSnapshot
+{
+public:
+    DataSnapshot();
+    int    count() const;
+    double x(int i) const;
+    double y(int i) const;
+    double logX(int i) const;
+    double logY(int i) const;
+    // Index span of the points with x in [xFrom, xTo], plus one
+    // point of context on each side
+    void range(double xFrom, double xTo, int& first, int& last) const;
+    // Number of points from i on (up to last) contiguous in pChunk from slot
+    int  span(int i, int last, const DataChunk*& pChunk, int& slot) const;
+
+ // Attributes
+ public:
+    // Limits of all the points, history included
+    double minx;
+    double maxx;
+    double miny;
+    double maxy;
+
+ protected:
+    friend class DataStream2D;
+    QVector<std::shared_ptr<const DataChunk>> chunks;
+    int  offset;  // Of the first point in the first chunk
+    int  nPoints;
+    bool bSorted; // x non decreasing
+};
+
+
+inline double
+DataSnapshot::x(int i) const {
+    i += offset;
+    return chunks.at(i >> DataChunk::shift)->x[i & (DataChunk::size-1)];
+}
+
+
+inline double
+DataSnapshot::y(int i) const {
+    i += offset;
+    return chunks.at(i >> DataChunk::shift)->y[i & (DataChunk::size-1)];
+}
+
+
+// Meaningful only for positive coordinates
+inline double
+DataSnapshot::logX(int i) const {
+    i += offset;
+    return chunks.at(i >> DataChunk::shift)->logX[i & (DataChunk::size-1)];
+}
+
+
+inline double
+DataSnapshot::logY(int i) const {
+    i += offset;
+    return chunks.at(i >> DataChunk::shift)->logY[i & (DataChunk::size-1)];
+}
+
+
+// The points are added by one thread, while any other thread can draw
+// the last published snapshot: the window needs no lock and no copy.
+// AddPoint() does not publish: the adding thread calls publish() once
+// for each batch of points. The history (pyramid and sample store) is
+// guarded by a mutex, taken once for each DataChunk::size points moved
+// to it and once for each query.
 class DataStream2D
 {
 public:
@@ -32,7 +187,10 @@ public:
     // Operations
     void setMaxPoints(int nPoints);
     int  getMaxPoints();
+    void setMemoryBudget(qint64 nBytes);
     void AddPoint(double pointX, double pointY);
+    void AddPoints(const double* pointsX, const double* pointsY, int nPoints);
+    void publish();
     void RemoveAllPoints();
     int  GetId();
     QString GetTitle();
@@ -42,19 +200,45 @@ public:
     void SetShowTitle(bool show);
     void SetTitle(QString myTitle);
     void SetShow(bool);
+    // The points window as published after the last points added
+    std::shared_ptr<const DataSnapshot> snapshot() const;
+    bool yLimits(const DataSnapshot& window, double xFrom, double xTo, double& yMin, double& yMax) const;
+    // The points that no longer fit in the window: aggregated
+    // in the pyramid and, one by one, in the sample store
+    bool   hasHistory() const;
+    void   selectHistory(double xFrom, double xTo, int maxBuckets, QVector<LodBucket>& buckets) const;
+    qint64 historyCount(double xFrom, double xTo) const;
+    bool   readHistory(double xFrom, double xTo, QVector<double>& x, QVector<double>& y);
+    bool   loadHistory(double xFrom, double xTo);
 
  // Attributes
  public:
-    QVector<double> m_pointArrayX;
-    QVector<double> m_pointArrayY;
-    double minx;
-    double maxx;
-    double miny;
-    double maxy;
     bool bShowCurveTitle;
     bool isShown;
 
+ protected:
+    void append(double x, double y);
+    void clearWindow();
+    void evict(double x, double y);
+    void flushHistory();
+    double& xAt(int i);
+    double& yAt(int i);
+
  protected:
     DataSetProperties Properties;
     int maxPoints;
+    QVector<std::shared_ptr<DataChunk>> chunks;
+    int    offset;
+    qint64 nAdded;
+    int    nPoints;
+    int    nDescents; // Points in the window smaller than the previous one
+    bool   bChanged;  // Since the last publish()
+    SlidingExtremum minX, maxX, minY, maxY;
+    // Evicted points not yet moved to the history
+    QVector<double> evictedX;
+    QVector<double> evictedY;
+    mutable QMutex historyMutex;
+    LodPyramid pyramid;
+    SampleStore store;
+    std::shared_ptr<const DataSnapshot> published;
 };
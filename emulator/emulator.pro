@@ -0,0 +1,10 @@
+# TPG 261 emulator on a pseudo terminal (Linux only, no Qt needed)
+TEMPLATE = app
+TARGET   = tpg261emu
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    tpg261emu.cpp
@@ -0,0 +1,470 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+// TPG 261 emulator.
+// Opens a pseudo terminal and speaks the TPG 261 serial protocol on it,
+// so that tgp261 can be run (and loaded) without a real gauge:
+// just point the "Serial Port" of tgp261 to the printed device.
+//
+// Usage:
+//    tpg261emu [--replay data.dat] [--speed N] [--baud B]
+//              [--rate 0|1|2] [--tau s] [--link path] [--quiet]
+//
+//    --replay file  Replays a file written by tgp261 (time [s], pressure)
+//                   instead of the synthetic pump-down curve.
+//    --speed N      Emulated time runs N times faster than real time.
+//    --baud B       Paces the output as a B baud line (0: as fast as
+//                   possible). Default 19200.
+//    --rate n       Initial continuous mode (COM,n). Default 1.
+//    --tau s        Time constant of the synthetic pump-down [s].
+//    --link path    Also creates a symbolic link to the pty slave.
+//    --quiet        Do not print the transmission statistics.
+//
+// Supported mnemonics: COM, PR1, TID, UNI, BAU; <ENQ> and <ETX>.
+// Every second the number of lines (and bytes) sent is printed on stderr.
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+
+#include <string>
+#include <vector>
+
+
+static const char ACK = 0x06;
+static const char NAK = 0x15;
+static const char ENQ = 0x05;
+static const char ETX = 0x03;
+
+
+static volatile sig_atomic_t bQuit = 0;
+
+
+static void
+onSignal(int) {
+    bQuit = 1;
+}
+
+
+static double
+monotonicSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return double(ts.tv_sec) + 1.0e-9*double(ts.tv_nsec);
+}
+
+
+class PressureSource
+{
+public:
+    PressureSource()
+        : tau(600.0)
+        , iNext(0)
+    {
+        srand48(261);
+    }
+
+    bool loadReplay(const char* sFileName) {
+        FILE* pFile = fopen(sFileName, "r");
+        if(!pFile)
+            return false;
+        char line[256];
+        while(fgets(line, sizeof(line), pFile)) {
+            if(line[0] == '#')
+                continue;
+            double t, p;
+            if(sscanf(line, "%lf %lf", &t, &p) == 2) {
+                times.push_back(t);
+                pressures.push_back(p);
+            }
+        }
+        fclose(pFile);
+        return !times.empty();
+    }
+
+    bool isReplay() const {
+        return !times.empty();
+    }
+
+    // Synthetic pump-down: exponential decay towards the base
+    // pressure with a little multiplicative noise
+    double synthetic(double t) const {
+        const double pAtm  = 1.0e3;
+        const double pBase = 5.0e-8;
+        double p = pBase + (pAtm-pBase)*exp(-t/tau) + 1.0e-6*exp(-t/(20.0*tau));
+        return p * (1.0 + 0.002*(drand48()-0.5));
+    }
+
+    // Recorded samples whose time has come, in replay mode
+    bool nextRecorded(double t, double& p) {
+        if(iNext >= times.size() || times[iNext]-times[0] > t)
+            return false;
+        p = pressures[iNext++];
+        return true;
+    }
+
+    double latestRecorded(double t) {
+        while(iNext+1 < times.size() && times[iNext+1]-times[0] <= t)
+            iNext++;
+        return iNext < pressures.size() ? pressures[iNext] : 0.0;
+    }
+
+    bool replayDone() const {
+        return iNext >= times.size();
+    }
+
+    double tau;
+
+private:
+    std::vector<double> times;
+    std::vector<double> pressures;
+    size_t iNext;
+};
+
+
+class Tpg261Emulator
+{
+public:
+    Tpg261Emulator(int masterFd, PressureSource* pSource, double speed, int baud, int comMode)
+        : fd(masterFd)
+        , pSource(pSource)
+        , speed(speed)
+        , bytesPerSecond(baud/10.0)
+        , comMode(comMode)
+        , bContinuous(true)
+        , units(0)
+        , t0(monotonicSeconds())
+        , tNextMeasure(0.0)
+        , tLineFree(0.0)
+        , nLines(0)
+        , nBytes(0)
+    {
+    }
+
+    // Emulated time [s]
+    double now() const {
+        return (monotonicSeconds()-t0) * speed;
+    }
+
+    void onInput(const char* pData, ssize_t nBytes) {
+        for(ssize_t i=0; i<nBytes; i++) {
+            const char c = pData[i];
+            // As soon as a character is received the
+            // continuous transmission stops
+            bContinuous = false;
+            if(c == ETX) {
+                input.clear();
+            }
+            else if(c == ENQ) {
+                input.clear();
+                answerEnquiry();
+            }
+            else if(c == '\n') {
+                while(!input.empty() && (input.back() == '\r'))
+                    input.pop_back();
+                if(!input.empty())
+                    onMnemonic(input);
+                input.clear();
+            }
+            else {
+                input.push_back(c);
+            }
+        }
+    }
+
+    // Continuous transmission. Returns the time [s, real] to wait
+    // before the next call.
+    double tick() {
+        if(!bContinuous)
+            return 0.1;
+        const double t = now();
+        if(pSource->isReplay()) {
+            double p;
+            while(pSource->nextRecorded(t, p))
+                sendMeasurement(p);
+            return 0.01;
+        }
+        if(t < tNextMeasure)
+            return (tNextMeasure-t) / speed;
+        sendMeasurement(pSource->synthetic(t));
+        tNextMeasure = t + comInterval();
+        return comInterval() / speed;
+    }
+
+    void printStatistics() {
+        fprintf(stderr, "%llu lines/s, %llu bytes/s%s\n",
+                (unsigned long long)nLines, (unsigned long long)nBytes,
+                bContinuous ? "" : " (continuous transmission stopped)");
+        nLines = 0;
+        nBytes = 0;
+    }
+
+    bool isFinished() const {
+        return pSource->isReplay() && pSource->replayDone();
+    }
+
+protected:
+    double comInterval() const {
+        if(comMode == 0) return 0.1;
+        if(comMode == 2) return 60.0;
+        return 1.0;
+    }
+
+    void onMnemonic(const std::string& sCommand) {
+        std::string sMnemonic = sCommand.substr(0, sCommand.find(','));
+        bool bHasParameter = sCommand.find(',') != std::string::npos;
+        int parameter = bHasParameter ? atoi(sCommand.c_str()+sMnemonic.size()+1) : -1;
+        if(sMnemonic == "COM") {
+            if(bHasParameter) {
+                if(parameter < 0 || parameter > 2) {
+                    sendNak();
+                    return;
+                }
+                comMode = parameter;
+            }
+            sendAck();
+            bContinuous  = true;
+            tNextMeasure = 0.0;
+            lastMnemonic.clear();
+            return;
+        }
+        if(sMnemonic == "UNI" && bHasParameter) {
+            if(parameter < 0 || parameter > 2) {
+                sendNak();
+                return;
+            }
+            units = parameter;
+        }
+        else if(sMnemonic == "BAU" && bHasParameter) {
+            // The pty has no baud rate: just pace the output
+            const int rates[] = {9600, 19200, 38400};
+            if(parameter < 0 || parameter > 2) {
+                sendNak();
+                return;
+            }
+            if(bytesPerSecond > 0.0)
+                bytesPerSecond = rates[parameter]/10.0;
+        }
+        else if(sMnemonic != "PR1" && sMnemonic != "TID" &&
+                sMnemonic != "UNI" && sMnemonic != "BAU")
+        {
+            sendNak();
+            return;
+        }
+        lastMnemonic = sMnemonic;
+        sendAck();
+    }
+
+    void answerEnquiry() {
+        char sAnswer[64];
+        if(lastMnemonic == "PR1") {
+            double t = now();
+            double p = pSource->isReplay() ? pSource->latestRecorded(t)
+                                           : pSource->synthetic(t);
+            formatMeasurement(p, sAnswer, sizeof(sAnswer));
+        }
+        else if(lastMnemonic == "TID") {
+            snprintf(sAnswer, sizeof(sAnswer), "PKR");
+        }
+        else if(lastMnemonic == "UNI") {
+            snprintf(sAnswer, sizeof(sAnswer), "%d", units);
+        }
+        else if(lastMnemonic == "BAU") {
+            snprintf(sAnswer, sizeof(sAnswer), "%d",
+                     bytesPerSecond >= 3840.0 ? 2 : bytesPerSecond >= 1920.0 ? 1 : 0);
+        }
+        else {
+            sendNak();
+            return;
+        }
+        sendLine(sAnswer);
+    }
+
+    void formatMeasurement(double p, char* sBuffer, size_t size) {
+        int status = 0;
+        if(p < 5.0e-9)   status = 1; // Underrange
+        if(p > 1.0e3)    status = 2; // Overrange
+        snprintf(sBuffer, size, "%d,%+.4E", status, p);
+    }
+
+    void sendMeasurement(double p) {
+        char sLine[64];
+        formatMeasurement(p, sLine, sizeof(sLine));
+        sendLine(sLine);
+    }
+
+    void sendAck() {
+        const char sAck[2] = {ACK, 0};
+        sendLine(sAck);
+    }
+
+    void sendNak() {
+        const char sNak[2] = {NAK, 0};
+        sendLine(sNak);
+    }
+
+    // Writes sLine<CR><LF>, paced as on a real serial line
+    void sendLine(const char* sLine) {
+        std::string sOut(sLine);
+        sOut += "\r\n";
+        if(bytesPerSecond > 0.0) {
+            double tNow = monotonicSeconds();
+            if(tLineFree < tNow)
+                tLineFree = tNow;
+            tLineFree += sOut.size()/bytesPerSecond;
+            double wait = tLineFree - tNow - sOut.size()/bytesPerSecond;
+            if(wait > 0.0)
+                usleep(useconds_t(wait*1.0e6));
+        }
+        size_t nWritten = 0;
+        while(nWritten < sOut.size()) {
+            ssize_t n = write(fd, sOut.data()+nWritten, sOut.size()-nWritten);
+            if(n < 0) {
+                if(errno == EINTR)
+                    continue;
+                if(errno == EAGAIN) { // Nobody reading: drop the rest
+                    break;
+                }
+                return;
+            }
+            nWritten += size_t(n);
+        }
+        nLines++;
+        nBytes += nWritten;
+    }
+
+private:
+    int fd;
+    PressureSource* pSource;
+    double speed;
+    double bytesPerSecond;
+    int comMode;
+    bool bContinuous;
+    int units;
+    double t0;
+    double tNextMeasure;
+    double tLineFree;
+    unsigned long long nLines;
+    unsigned long long nBytes;
+    std::string input;
+    std::string lastMnemonic;
+};
+
+
+int
+main(int argc, char* argv[]) {
+    const char* sReplay = nullptr;
+    const char* sLink   = nullptr;
+    double speed = 1.0;
+    int baud     = 19200;
+    int comMode  = 1;
+    bool bQuiet  = false;
+    PressureSource source;
+
+    for(int i=1; i<argc; i++) {
+        bool bHasValue = i+1 < argc;
+        if(!strcmp(argv[i], "--replay") && bHasValue)     sReplay = argv[++i];
+        else if(!strcmp(argv[i], "--speed") && bHasValue) speed = atof(argv[++i]);
+        else if(!strcmp(argv[i], "--baud") && bHasValue)  baud = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--rate") && bHasValue)  comMode = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--tau") && bHasValue)   source.tau = atof(argv[++i]);
+        else if(!strcmp(argv[i], "--link") && bHasValue)  sLink = argv[++i];
+        else if(!strcmp(argv[i], "--quiet"))              bQuiet = true;
+        else {
+            fprintf(stderr, "Usage: %s [--replay data.dat] [--speed N] [--baud B]"
+                            " [--rate 0|1|2] [--tau s] [--link path] [--quiet]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(speed <= 0.0 || comMode < 0 || comMode > 2 || source.tau <= 0.0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+    if(sReplay && !source.loadReplay(sReplay)) {
+        fprintf(stderr, "Unable to read samples from %s\n", sReplay);
+        return 1;
+    }
+
+    int masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if(masterFd < 0 || grantpt(masterFd) || unlockpt(masterFd)) {
+        perror("posix_openpt");
+        return 1;
+    }
+    const char* sSlave = ptsname(masterFd);
+    // Keep the slave open (and raw) so that the master never sees
+    // EIO while tgp261 is not connected
+    int slaveFd = open(sSlave, O_RDWR | O_NOCTTY);
+    if(slaveFd < 0) {
+        perror(sSlave);
+        return 1;
+    }
+    struct termios tio;
+    tcgetattr(slaveFd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slaveFd, TCSANOW, &tio);
+    fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+
+    if(sLink) {
+        unlink(sLink);
+        if(symlink(sSlave, sLink))
+            perror(sLink);
+    }
+    printf("TPG 261 emulator on %s\n", sLink ? sLink : sSlave);
+    fflush(stdout);
+
+    signal(SIGINT,  onSignal);
+    signal(SIGTERM, onSignal);
+
+    Tpg261Emulator emulator(masterFd, &source, speed, baud, comMode);
+    double tStatistics = monotonicSeconds() + 1.0;
+    while(!bQuit && !emulator.isFinished()) {
+        double wait = emulator.tick();
+        if(wait > 0.1) wait = 0.1;
+        struct pollfd pfd;
+        pfd.fd     = masterFd;
+        pfd.events = POLLIN;
+        if(poll(&pfd, 1, int(wait*1000.0)) > 0 && (pfd.revents & POLLIN)) {
+            char buffer[256];
+            ssize_t n = read(masterFd, buffer, sizeof(buffer));
+            if(n > 0)
+                emulator.onInput(buffer, n);
+        }
+        if(!bQuiet && monotonicSeconds() >= tStatistics) {
+            emulator.printStatistics();
+            tStatistics += 1.0;
+        }
+    }
+    if(sLink)
+        unlink(sLink);
+    close(slaveFd);
+    close(masterFd);
+    return 0;
+}
@@ -0,0 +1,235 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include "journal.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <cstring>
+
+#if defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
+
+static const char recordMagic[4] = {'J','R','N','L'};
+
+
+struct JournalRecordHeader
+{
+    char    magic[4];
+    quint32 type;
+    quint32 length;   // Of the payload
+    quint32 crc;      // CRC-32 of type, length and payload
+};
+
+
+struct Crc32Table
+{
+    Crc32Table() {
+        for(quint32 i=0; i<256; i++) {
+            quint32 c = i;
+            for(int k=0; k<8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+    }
+    quint32 entries[256];
+};
+
+
+// CRC-32 (IEEE 802.3, as in zlib)
+static quint32
+crc32(quint32 crc, const char* pData, qint64 nBytes) {
+    static const Crc32Table table;
+    crc = ~crc;
+    for(qint64 i=0; i<nBytes; i++)
+        crc = table.entries[(crc ^ quint8(pData[i])) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+
+static quint32
+recordCrc(quint32 type, quint32 length, const char* pPayload, qint64 nBytes) {
+    quint32 crc = crc32(0, reinterpret_cast<const char*>(&type), sizeof(type));
+    crc = crc32(crc, reinterpret_cast<const char*>(&length), sizeof(length));
+    return crc32(crc, pPayload, nBytes);
+}
+
+
+void
+syncToDisk(QFile& file) {
+    file.flush();
+#if defined(Q_OS_LINUX)
+    fdatasync(file.handle());
+#endif
+}
+
+
+// An existing journal is truncated
+bool
+Journal::open(QString sFileName) {
+    file.setFileName(sFileName);
+    return file.open(QIODevice::WriteOnly|QIODevice::Truncate);
+}
+
+
+bool
+Journal::isOpen() const {
+    return file.isOpen();
+}
+
+
+void
+Journal::appendOpen(QString sOutputFile, bool bText) {
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << bText << sOutputFile;
+    appendRecord(OpenRecord, payload);
+}
+
+
+void
+Journal::appendCheckpoint(QString sOutputFile, qint64 validLength, bool bText) {
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << bText << sOutputFile << validLength;
+    appendRecord(CheckpointRecord, payload);
+}
+
+
+void
+Journal::appendData(const char* pData, int nBytes) {
+    if(nBytes > 0)
+        appendRecord(DataRecord, QByteArray(), pData, nBytes);
+}
+
+
+void
+Journal::appendRecord(quint32 type, const QByteArray& prefix, const char* pData, int nBytes) {
+    if(!file.isOpen())
+        return;
+    JournalRecordHeader header;
+    std::memcpy(header.magic, recordMagic, sizeof(recordMagic));
+    header.type   = type;
+    header.length = quint32(prefix.size() + nBytes);
+    header.crc    = recordCrc(type, header.length, prefix.constData(), prefix.size());
+    if(nBytes > 0) // CRC-32 can be continued over the payload pieces
+        header.crc = crc32(header.crc, pData, nBytes);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(prefix);
+    if(nBytes > 0)
+        file.write(pData, nBytes);
+}
+
+
+void
+Journal::commit(bool bSync) {
+    if(!file.isOpen())
+        return;
+    if(bSync)
+        syncToDisk(file);
+    else
+        file.flush();
+}
+
+
+// Called once the output file is safely on disk
+void
+Journal::reset() {
+    if(!file.isOpen())
+        return;
+    file.flush();
+    file.resize(0);
+    file.seek(0);
+}
+
+
+qint64
+Journal::size() const {
+    return file.isOpen() ? file.size() : 0;
+}
+
+
+void
+Journal::remove() {
+    if(file.isOpen())
+        file.close();
+    file.remove();
+}
+
+
+// Replays the journal: a torn or corrupted record ends the recovery
+bool
+Journal::recover(QString sFileName, QStringList& recoveredFiles, QString& sError) {
+    QFile journalFile(sFileName);
+    if(!journalFile.open(QIODevice::ReadOnly)) {
+        sError = journalFile.errorString();
+        return false;
+    }
+    QFile outFile;
+    QByteArray payload;
+    JournalRecordHeader header;
+    while(journalFile.read(reinterpret_cast<char*>(&header), sizeof(header)) == sizeof(header)) {
+        if(std::memcmp(header.magic, recordMagic, sizeof(recordMagic)))
+            break;
+        payload = journalFile.read(header.length);
+        if(payload.size() != int(header.length) ||
+           recordCrc(header.type, header.length, payload.constData(), payload.size()) != header.crc)
+            break;
+        if(header.type == DataRecord) {
+            if(outFile.isOpen())
+                outFile.write(payload);
+            continue;
+        }
+        QDataStream stream(payload);
+        bool bText;
+        QString sOutputFile;
+        stream >> bText >> sOutputFile;
+        if(outFile.isOpen())
+            outFile.close();
+        outFile.setFileName(sOutputFile);
+        QIODevice::OpenMode mode = QIODevice::WriteOnly;
+        if(bText)
+            mode |= QIODevice::Text;
+        if(header.type == CheckpointRecord) {
+            // Drop whatever was written after the checkpoint
+            qint64 validLength;
+            stream >> validLength;
+            if(!outFile.open(mode|QIODevice::Append) || !outFile.resize(validLength)) {
+                sError = QString("%1: %2").arg(sOutputFile, outFile.errorString());
+                return false;
+            }
+            outFile.seek(validLength);
+        }
+        else if(!outFile.open(mode|QIODevice::Truncate)) {
+            sError = QString("%1: %2").arg(sOutputFile, outFile.errorString());
+            return false;
+        }
+        if(!recoveredFiles.contains(sOutputFile))
+            recoveredFiles.append(sOutputFile);
+    }
+    if(outFile.isOpen())
+        syncToDisk(outFile);
+    return true;
+}
@@ -0,0 +1,68 @@
+// MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+
+// Append-only write-ahead journal of the output files.
+// Every group commit of OutputWriter is first appended here as a
+// DataRecord protected by a CRC-32 and (optionally) synced to disk,
+// so that the output files themselves need not be synced.
+// At a checkpoint the output file is synced and the journal restarts
+// with a CheckpointRecord holding the valid length of the file.
+// After a crash recover() rebuilds the output files up to the last
+// valid record.
+class Journal
+{
+public:
+    enum RecordType {
+        OpenRecord       = 1, // A new (truncated) output file
+        CheckpointRecord = 2, // The output file is valid up to a length
+        DataRecord       = 3  // Bytes appended to the current output file
+    };
+
+    bool open(QString sFileName);
+    bool isOpen() const;
+    void appendOpen(QString sOutputFile, bool bText);
+    void appendCheckpoint(QString sOutputFile, qint64 validLength, bool bText);
+    void appendData(const char* pData, int nBytes);
+    void commit(bool bSync);
+    void reset();
+    qint64 size() const;
+    void remove();
+
+    static bool recover(QString sFileName, QStringList& recoveredFiles, QString& sError);
+
+protected:
+    void appendRecord(quint32 type, const QByteArray& prefix,
+                      const char* pData = nullptr, int nBytes = 0);
+
+protected:
+    QFile file;
+};
+
+
+void syncToDisk(QFile& file);
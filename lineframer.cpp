@@ -0,0 +1,125 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include "lineframer.h"
+
+#include <string.h>
+
+
+LineFramer::LineFramer(int capacityPow2)
+    : mask(0)
+    , head(0)
+    , scanned(0)
+    , tail(0)
+{
+    int capacity = 64;
+    while(capacity < capacityPow2)
+        capacity <<= 1;
+    buffer.resize(capacity);
+    wrappedLine.reserve(capacity);
+    mask = quint32(capacity-1);
+}
+
+
+// Largest contiguous free region where the serial port can
+// deposit the next bytes.
+char*
+LineFramer::writePointer(int& nContiguous) {
+    const quint32 capacity = mask+1;
+    const quint32 offset = tail & mask;
+    quint32 nFree = capacity - (tail-head);
+    if(nFree > capacity-offset)
+        nFree = capacity-offset;
+    nContiguous = int(nFree);
+    return buffer.data() + offset;
+}
+
+
+void
+LineFramer::commit(int nBytes) {
+    tail += quint32(nBytes);
+}
+
+
+// Appends to lines every complete record found in the ring, with the
+// terminating CR/LF removed, and to bytesAfter the number of bytes
+// committed after its LF. Empty records are skipped.
+// Returns the number of records appended.
+int
+LineFramer::takeLines(QVector<QByteArray>& lines, QVector<int>& bytesAfter) {
+    const char* pData = buffer.constData();
+    const quint32 capacity = mask+1;
+    int nLines = 0;
+    while(scanned != tail) {
+        // Search the contiguous part of the unscanned bytes
+        const quint32 offset = scanned & mask;
+        quint32 nBytes = tail - scanned;
+        if(nBytes > capacity-offset)
+            nBytes = capacity-offset;
+        const char* pLf = static_cast<const char*>(memchr(pData+offset, '\n', nBytes));
+        if(!pLf) {
+            scanned += nBytes;
+            continue;
+        }
+        scanned += quint32(pLf-(pData+offset)) + 1;
+        // The record is [head, scanned)
+        quint32 first = head;
+        quint32 last  = scanned-1; // On the LF
+        head = scanned;
+        while(last != first && (pData[(last-1) & mask] == '\r' ||
+                                pData[(last-1) & mask] == '\n'))
+            last--;
+        while(first != last && pData[first & mask] == '\r')
+            first++;
+        const int length = int(last-first);
+        if(length == 0)
+            continue;
+        if((first & mask) + quint32(length) <= capacity) {
+            lines.append(QByteArray::fromRawData(pData+(first & mask), length));
+        }
+        else { // The record straddles the end of the ring
+            const int nTop = int(capacity-(first & mask));
+            wrappedLine.resize(0);
+            wrappedLine.append(pData+(first & mask), nTop);
+            wrappedLine.append(pData, length-nTop);
+            lines.append(QByteArray::fromRawData(wrappedLine.constData(), length));
+        }
+        bytesAfter.append(int(tail-scanned));
+        nLines++;
+    }
+    return nLines;
+}
+
+
+int
+LineFramer::pendingBytes() const {
+    return int(tail-head);
+}
+
+
+void
+LineFramer::clear() {
+    head    = 0;
+    scanned = 0;
+    tail    = 0;
+}
@@ -0,0 +1,56 @@
+// MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QByteArray>
+#include <QVector>
+
+
+// Fixed capacity byte ring that splits the incoming serial stream
+// into CR/LF terminated records.
+// Bytes are read straight into the ring (writePointer()/commit())
+// and takeLines() returns, in a single pass, every complete record
+// received so far. Nothing is ever moved inside the ring: the
+// returned QByteArrays are views on it (only a record straddling
+// the end of the ring is copied) and stay valid until the next
+// commit() or clear().
+// For each record takeLines() also tells how many bytes were received
+// after its LF, to place it in time within a burst.
+class LineFramer
+{
+public:
+    explicit LineFramer(int capacityPow2 = 4096);
+    char* writePointer(int& nContiguous);
+    void  commit(int nBytes);
+    int   takeLines(QVector<QByteArray>& lines, QVector<int>& bytesAfter);
+    int   pendingBytes() const;
+    void  clear();
+
+protected:
+    QByteArray buffer;
+    QByteArray wrappedLine;
+    quint32 mask;
+    quint32 head;    // First byte not yet returned
+    quint32 scanned; // First byte not yet searched for LF
+    quint32 tail;    // First free byte
+};
@@ -35,8 +35,11 @@
 
 
 #include "mainwindow.h"
+#include "binarylog.h"
+#include "compressedlog.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
 
 int
 main(int argc, char *argv[]) {
@@ -48,6 +51,42 @@ main(int argc, char *argv[]) {
     QCoreApplication::setApplicationName("Oscilloscope");
     QCoreApplication::setApplicationVersion("0.0.1");
 
+    // File conversions run without opening the main window:
+    //    tgp261 --to-binary data.dat data.bin
+    //    tgp261 --to-compressed data.dat data.tpz
+    //    tgp261 --to-text data.bin data.dat (or data.tpz data.dat)
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption toBinaryOption("to-binary", "Convert a text file to the binary format.");
+    QCommandLineOption toCompressedOption("to-compressed", "Convert a text file to the compressed format.");
+    QCommandLineOption toTextOption("to-text", "Convert a binary or compressed file to the text format.");
+    parser.addOption(toBinaryOption);
+    parser.addOption(toCompressedOption);
+    parser.addOption(toTextOption);
+    parser.addPositionalArgument("input", "File to convert.");
+    parser.addPositionalArgument("output", "Converted file.");
+    parser.process(a);
+    if(parser.isSet(toBinaryOption) || parser.isSet(toCompressedOption) || parser.isSet(toTextOption)) {
+        const QStringList args = parser.positionalArguments();
+        if(args.count() != 2) {
+            qCritical("Expected an input and an output file name");
+            return 1;
+        }
+        QString sError;
+        bool bOk;
+        if(parser.isSet(toBinaryOption))
+            bOk = convertTextToBinary(args.at(0), args.at(1), sError);
+        else if(parser.isSet(toCompressedOption))
+            bOk = convertTextToCompressed(args.at(0), args.at(1), sError);
+        else if(CompressedLogReader::isCompressedLog(args.at(0)))
+            bOk = convertCompressedToText(args.at(0), args.at(1), sError);
+        else
+            bOk = convertBinaryToText(args.at(0), args.at(1), sError);
+        if(!bOk)
+            qCritical("%s", qPrintable(sError));
+        return bOk ? 0 : 1;
+    }
+
     MainWindow* pMainWindow;
     pMainWindow = new MainWindow();
 
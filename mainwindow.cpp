@@ -23,24 +23,53 @@
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "textrunparser.h"
 //#include "plot2d.h"
 
 #include <QSettings>
-#include <QFile>
 #include <QDir>
 #include <QFileDialog>
+#include <QInputDialog>
+#include <QCloseEvent>
 #include <QMessageBox>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QProgressDialog>
+#include <QFutureWatcher>
+#include <QEventLoop>
+#include <QThread>
+#include <QtConcurrent>
+#include <limits>
+
+
+// Time between the index entries of the text segments [s]
+static const double indexIntervalS = 10.0;
 
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , pTgp261(new tgp261())
-    , pOutputFile(nullptr)
+    , blockFirstTime(0.0)
+    , segment(0)
+    , segmentBytes(0)
+    , lastIndexedTime(0.0)
     , pPlotMeasurements(nullptr)
+    , pPlotLoaded(nullptr)
+    , startMeasuringNs(0)
     , sBaseDir(QDir::homePath())
     , sOutFileName("data.dat")
+    , sPortName("/dev/ttyUSB0")
+    , baudRate(19200)
+    , acquisitionRate(tgp261::Rate1s)
+    , outputFormat(TextFormat)
+    , compressedChunkMs(600000)
+    , segmentMinutes(0)
+    , segmentMaxBytes(0)
+    , bJournal(true)
     , bRunning(false)
+    , bLoading(false)
+    , lastGaugeStatus(PressureSample::MeasurementOk)
 {
     QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
     ui->setupUi(this);
@@ -48,9 +77,37 @@ MainWindow::MainWindow(QWidget *parent)
     ui->editInfo->setPlainText(sSampleInfo);
     ui->editPath->setText(sBaseDir);
     ui->editFileName->setText(sOutFileName);
-    pTgp261 = new tgp261();
-    connect(pTgp261, SIGNAL(dataReady(QString)),
-            this, SLOT(onNewData(QString)));
+    ui->editPort->setText(sPortName);
+    ui->comboBaud->addItem("9600",  9600);
+    ui->comboBaud->addItem("19200", 19200);
+    ui->comboBaud->addItem("38400", 38400);
+    ui->comboBaud->setCurrentIndex(qMax(0, ui->comboBaud->findData(baudRate)));
+    ui->comboRate->addItem("100 ms (COM,0)", tgp261::Rate100ms);
+    ui->comboRate->addItem("1 s (COM,1)",    tgp261::Rate1s);
+    ui->comboRate->addItem("1 min (COM,2)",  tgp261::Rate1min);
+    ui->comboRate->addItem("Polled (PR1)",   tgp261::RatePolled);
+    ui->comboRate->setCurrentIndex(qMax(0, ui->comboRate->findData(acquisitionRate)));
+    ui->comboFormat->addItem("Text",   TextFormat);
+    ui->comboFormat->addItem("Binary", BinaryFormat);
+    ui->comboFormat->addItem("Compressed", CompressedFormat);
+    ui->comboFormat->setCurrentIndex(qMax(0, ui->comboFormat->findData(outputFormat)));
+    ui->spinSegment->setValue(segmentMinutes);
+    if(bJournal)
+        outputWriter.setJournal(journalFileName());
+    pTgp261->setSerialPort(sPortName, baudRate);
+    pTgp261->setAcquisitionRate(acquisitionRate);
+    connect(pTgp261, SIGNAL(initialized()),
+            this, SLOT(onTgp261Initialized()));
+    connect(pTgp261, SIGNAL(samplesAvailable()),
+            this, SLOT(onSamplesAvailable()));
+    connect(pTgp261, SIGNAL(connectionError(QString,QString)),
+            this, SLOT(onConnectionError(QString,QString)));
+    connect(pTgp261, SIGNAL(warning(QString)),
+            this, SLOT(onWarning(QString)));
+    connect(&outputWriter, SIGNAL(writeError(QString)),
+            this, SLOT(onWriterError(QString)));
+    connect(&indexWriter, SIGNAL(writeError(QString)),
+            this, SLOT(onWriterError(QString)));
 }
 
 
@@ -67,6 +124,9 @@ MainWindow::~MainWindow() {
     if(pPlotMeasurements)
         delete pPlotMeasurements;
     pPlotMeasurements = nullptr;
+    if(pPlotLoaded)
+        delete pPlotLoaded;
+    pPlotLoaded = nullptr;
     delete ui;
     QApplication::restoreOverrideCursor();
 }
@@ -74,16 +134,22 @@ MainWindow::~MainWindow() {
 
 void
 MainWindow::closeEvent(QCloseEvent *event) {
-    Q_UNUSED(event)
-    if(pOutputFile) {
-        if(pOutputFile->isOpen())
-            pOutputFile->close();
-        pOutputFile->deleteLater();
-        pOutputFile = nullptr;
+    // The loading run still uses the window (and its mapped file)
+    if(bLoading) {
+        ui->statusbar->showMessage("Cancel the loading of the run first", 5000);
+        event->ignore();
+        return;
     }
+    if(bRunning)
+        writeBlock();
+    outputWriter.close();
+    indexWriter.close();
     if(pPlotMeasurements)
         delete pPlotMeasurements;
     pPlotMeasurements = nullptr;
+    if(pPlotLoaded)
+        delete pPlotLoaded;
+    pPlotLoaded = nullptr;
 }
 
 
@@ -93,6 +159,18 @@ MainWindow::restoreSettings() {
     sSampleInfo    = settings.value("FileTabSampleInfo", "").toString();
     sBaseDir       = settings.value("FileTabBaseDir", sBaseDir).toString();
     sOutFileName   = settings.value("FileTabOutFileName", sOutFileName).toString();
+    sPortName       = settings.value("SerialPortName", sPortName).toString();
+    baudRate        = settings.value("SerialBaudRate", baudRate).toInt();
+    acquisitionRate = settings.value("AcquisitionRate", acquisitionRate).toInt();
+    outputFormat    = settings.value("OutputFormat", outputFormat).toInt();
+    writerPolicy.flushRecords     = settings.value("WriterFlushRecords", writerPolicy.flushRecords).toInt();
+    writerPolicy.flushMs          = settings.value("WriterFlushMs", writerPolicy.flushMs).toInt();
+    writerPolicy.bSync            = settings.value("WriterSync", writerPolicy.bSync).toBool();
+    writerPolicy.preallocateBytes = settings.value("WriterPreallocateMB", writerPolicy.preallocateBytes>>20).toLongLong() << 20;
+    compressedChunkMs = 1000*settings.value("CompressedChunkSeconds", compressedChunkMs/1000).toInt();
+    segmentMinutes    = settings.value("SegmentMinutes", segmentMinutes).toInt();
+    segmentMaxBytes   = settings.value("SegmentMaxMB", segmentMaxBytes>>20).toLongLong() << 20;
+    bJournal          = settings.value("WriterJournal", bJournal).toBool();
 }
 
 
@@ -103,12 +181,25 @@ MainWindow::saveSettings() {
     settings.setValue("FileTabSampleInfo", sSampleInfo);
     settings.setValue("FileTabBaseDir", sBaseDir);
     settings.setValue("FileTabOutFileName", sOutFileName);
+    settings.setValue("SerialPortName", sPortName);
+    settings.setValue("SerialBaudRate", baudRate);
+    settings.setValue("AcquisitionRate", acquisitionRate);
+    settings.setValue("OutputFormat", outputFormat);
+    settings.setValue("WriterFlushRecords", writerPolicy.flushRecords);
+    settings.setValue("WriterFlushMs", writerPolicy.flushMs);
+    settings.setValue("WriterSync", writerPolicy.bSync);
+    settings.setValue("WriterPreallocateMB", writerPolicy.preallocateBytes >> 20);
+    settings.setValue("CompressedChunkSeconds", compressedChunkMs/1000);
+    settings.setValue("SegmentMinutes", segmentMinutes);
+    settings.setValue("SegmentMaxMB", segmentMaxBytes >> 20);
+    settings.setValue("WriterJournal", bJournal);
 }
 
 
 void
 MainWindow::show() {
     QMainWindow::show();
+    recoverJournal();
     ui->statusbar->showMessage("Initializing TGP261 ...");
     QCoreApplication::processEvents();
     if(!pTgp261->Init()) {
@@ -117,10 +208,9 @@ MainWindow::show() {
         QCoreApplication::processEvents();
     }
     else
-        ui->statusbar->showMessage("TGP261 Initialized");
+        ui->statusbar->showMessage("Connecting to TGP261 ...");
 
     pPlotMeasurements = new Plot2D(nullptr, "Pressure [mbar] vs Time [s]");
-    pPlotMeasurements->setMaxPoints(3000);
     pPlotMeasurements->SetLimits(0.0, 1.0, 0.1, 1.0, true, true, false, false);
     // Datasets
     pPlotMeasurements->NewDataSet(0,                   //Id
@@ -142,21 +232,235 @@ MainWindow::show() {
     pPlotMeasurements->UpdatePlot();
     pPlotMeasurements->show();
     startMeasuringTime = QDateTime::currentDateTime();
+    startMeasuringNs   = monotonicNSecs();
     QApplication::restoreOverrideCursor();
 }
 
 
+QString
+MainWindow::journalFileName() const {
+    QString sDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(sDir);
+    return sDir + "/output.journal";
+}
+
+
+// A journal left behind means that the last acquisition
+// did not end: its output files are rebuilt from it.
+void
+MainWindow::recoverJournal() {
+    QString sJournal = journalFileName();
+    if(!QFile::exists(sJournal))
+        return;
+    ui->statusbar->showMessage("Recovering the interrupted acquisition...");
+    QCoreApplication::processEvents();
+    QStringList recoveredFiles;
+    QString sError;
+    if(!Journal::recover(sJournal, recoveredFiles, sError)) {
+        QMessageBox::critical(this,
+                              "Error: Unable to Recover the Interrupted Acquisition",
+                              QString("%1\nThe journal %2 will be overwritten by the next acquisition.")
+                              .arg(sError, sJournal));
+        return;
+    }
+    QFile::remove(sJournal);
+    if(!recoveredFiles.isEmpty())
+        QMessageBox::information(this,
+                                 "Interrupted Acquisition Recovered",
+                                 recoveredFiles.join("\n"));
+}
+
+
 void
-MainWindow::onNewData(QString sData) {
-    double y = sData.toDouble();
-    currentTime = QDateTime::currentDateTime();
-    double x = startMeasuringTime.secsTo(currentTime);
+MainWindow::onConnectionError(QString sError, QString sDevice) {
+    QMessageBox msgBox;
+    msgBox.setWindowTitle(QCoreApplication::applicationName());
+    msgBox.setIcon(QMessageBox::Critical);
+    msgBox.setText(QString("Error Opening Device File.\n%1")
+                   .arg(sError));
+    msgBox.setInformativeText(sDevice);
+    msgBox.setStandardButtons(QMessageBox::Close);
+    msgBox.setDefaultButton(QMessageBox::Close);
+    msgBox.exec();
+}
+
+
+// Transient problems do not interrupt the acquisition:
+// they are only shown in the status bar.
+void
+MainWindow::onWarning(QString sMessage) {
+    ui->statusbar->showMessage(sMessage, 5000);
+}
+
+
+// Kept in the status bar until the end of the acquisition
+void
+MainWindow::onWriterError(QString sError) {
+    sWriterError = sError;
+    ui->statusbar->showMessage(sError);
+}
+
+
+void
+MainWindow::onTgp261Initialized() {
+    ui->statusbar->showMessage(QString("TGP261 Initialized: %1 at %2 baud")
+                               .arg(pTgp261->gaugeId())
+                               .arg(pTgp261->currentBaudRate()));
+}
+
+
+// Drain everything the acquisition thread has queued so far
+// and repaint only once for the whole batch.
+void
+MainWindow::onSamplesAvailable() {
+    PressureSample sample;
+    bool bNewSamples = false;
+    while(pTgp261->takeSample(sample)) {
+        processSample(sample);
+        bNewSamples = true;
+    }
+    if(textEncoder.records() > 0) {
+        appendOutput(textEncoder.data(), textEncoder.size(), textEncoder.records());
+        textEncoder.clear();
+    }
     if(bRunning) {
-        QString sData = QString("%1 %2\n")
-                                .arg(x, 12, 'g', 6, ' ')
-                                .arg(y, 12, 'g', 6, ' ');
-        pOutputFile->write(sData.toLocal8Bit());
-        pOutputFile->flush();
+        // Compressed chunks need many samples to be effective:
+        // meanwhile the open one is written as the tail of the file
+        const int blockMs = (outputFormat == CompressedFormat) ? compressedChunkMs : writerPolicy.flushMs;
+        if(blockTimer.elapsed() >= blockMs)
+            writeBlock();
+        else if(tailTimer.elapsed() >= writerPolicy.flushMs)
+            writeTail();
+        if((segmentMaxBytes > 0 && segmentBytes >= segmentMaxBytes) ||
+           (segmentMinutes > 0 && segmentTimer.elapsed() >= qint64(segmentMinutes)*60000))
+            rotateSegment();
+    }
+    if(bNewSamples && pPlotMeasurements) {
+        pPlotMeasurements->PublishPoints();
+        pPlotMeasurements->UpdatePlot();
+    }
+    if(bRunning && writerStatusTimer.elapsed() >= 1000)
+        showWriterStatus();
+}
+
+
+// Short blocks are written too, so that no more than
+// writerPolicy.flushMs of samples wait in memory.
+void
+MainWindow::writeBlock() {
+    blockTimer.restart();
+    tailTimer.restart();
+    const QByteArray* pBlock = nullptr;
+    int count = binaryEncoder.pendingSamples();
+    if(count > 0)
+        pBlock = &binaryEncoder.finishBlock();
+    else if((count = compressedEncoder.pendingSamples()) > 0)
+        pBlock = &compressedEncoder.finishChunk();
+    if(!pBlock)
+        return;
+    addIndexEntry(blockFirstTime, segmentBytes);
+    appendOutput(pBlock->constData(), pBlock->size(), count);
+}
+
+
+// The open chunk is rewritten at the end of the file until it is
+// closed: a crash loses at most writerPolicy.flushMs of samples.
+void
+MainWindow::writeTail() {
+    tailTimer.restart();
+    if(compressedEncoder.pendingSamples() > 0)
+        outputWriter.setTail(compressedEncoder.peekChunk());
+}
+
+
+void
+MainWindow::appendOutput(const char* pData, int nBytes, int nRecords) {
+    outputWriter.append(pData, nBytes, nRecords);
+    segmentBytes += nBytes;
+}
+
+
+bool
+MainWindow::isSegmented() const {
+    return segmentMinutes > 0 || segmentMaxBytes > 0;
+}
+
+
+QString
+MainWindow::outputFileName() const {
+    QString sFileName = sBaseDir + "/" + sOutFileName;
+    if(isSegmented())
+        sFileName = SegmentIndex::segmentFileName(sFileName, segment);
+    return sFileName;
+}
+
+
+void
+MainWindow::addIndexEntry(double time, qint64 offset) {
+    if(!isSegmented())
+        return;
+    indexWriter.append(SegmentIndex::entry(time, segment, offset));
+    lastIndexedTime = time;
+}
+
+
+// The new segment has its own header, but keeps the time origin
+void
+MainWindow::rotateSegment() {
+    writeBlock();
+    segment++;
+    segmentBytes    = 0;
+    lastIndexedTime = -std::numeric_limits<double>::infinity();
+    segmentTimer.restart();
+    outputWriter.rotate(outputFileName());
+    writeFileHeader();
+}
+
+
+void
+MainWindow::showWriterStatus() {
+    writerStatusTimer.restart();
+    if(!sWriterError.isEmpty())
+        return;
+    ui->statusbar->showMessage(QString("Measure in Progress... (queued: %1 bytes, write: %2 ms, max: %3 ms)")
+                               .arg(outputWriter.queuedBytes())
+                               .arg(outputWriter.lastWriteLatencyUs()*1.0e-3, 0, 'f', 1)
+                               .arg(outputWriter.maxWriteLatencyUs()*1.0e-3, 0, 'f', 1));
+}
+
+
+void
+MainWindow::processSample(const PressureSample& sample) {
+    if(sample.status != lastGaugeStatus) {
+        lastGaugeStatus = sample.status;
+        ui->statusbar->showMessage(QString("Gauge: %1")
+                                   .arg(tgp261::statusDescription(sample.status)));
+    }
+    double x = double(sample.monotonicNs-startMeasuringNs) * 1.0e-9;
+    // The binary files keep the gauge status of every sample
+    if(bRunning && outputFormat == BinaryFormat) {
+        if(binaryEncoder.pendingSamples() == 0)
+            blockFirstTime = x;
+        binaryEncoder.append(x, sample.pressure, sample.status);
+        if(binaryEncoder.isBlockFull())
+            writeBlock();
+    }
+    else if(bRunning && outputFormat == CompressedFormat) {
+        if(compressedEncoder.pendingSamples() == 0)
+            blockFirstTime = x;
+        compressedEncoder.append(x, sample.pressure, sample.status);
+        if(compressedEncoder.isChunkFull())
+            writeBlock();
+    }
+    if(!sample.hasPressure())
+        return;
+    double y = sample.pressure;
+    if(bRunning) {
+        if(outputFormat == TextFormat) {
+            if(x-lastIndexedTime >= indexIntervalS)
+                addIndexEntry(x, segmentBytes+textEncoder.size());
+            textEncoder.append(x, y);
+        }
         if(pPlotMeasurements) {
             pPlotMeasurements->NewPoint(1, x, y);
         }
@@ -166,9 +470,6 @@ MainWindow::onNewData(QString sData) {
             pPlotMeasurements->NewPoint(0, x, y);
         }
     }
-    if(pPlotMeasurements) {
-        pPlotMeasurements->UpdatePlot();
-    }
 }
 
 
@@ -199,11 +500,13 @@ MainWindow::checkFileName() {
         ui->editFileName->setFocus();
         return false;
     }
-    if(QDir(sBaseDir).exists(sOutFileName)) {
+    segment = 0;
+    QString sFirstFileName = QFileInfo(outputFileName()).fileName();
+    if(QDir(sBaseDir).exists(sFirstFileName)) {
         QMessageBox* msg = new QMessageBox(
                     QMessageBox::Question,
                     QString("File Exists"),
-                    QString("Do you want overwrite\n%1 ?").arg(sOutFileName),
+                    QString("Do you want overwrite\n%1 ?").arg(sFirstFileName),
                     QMessageBox::Yes|QMessageBox::No);
         int iAnswer = msg->exec();
         if(iAnswer == QMessageBox::No) {
@@ -222,23 +525,33 @@ MainWindow::on_buttonStart_clicked() {
             ui->statusbar->showMessage("Unable to Initialize TGP261 ...");
         }
         else {
-            ui->statusbar->showMessage("TGP261 Initialized");
+            ui->statusbar->showMessage("Connecting to TGP261 ...");
             ui->buttonStart->setText("Start");
         }
         return;
     }
     if(ui->buttonStart->text() == QString("Stop")) {
         bRunning = false;
+        writeBlock();
+        outputWriter.close();
+        indexWriter.close();
         ui->buttonStart->setText("Start");
         ui->buttonPath->setEnabled(true);
         ui->editFileName->setEnabled(true);
         ui->editInfo->setEnabled(true);
+        ui->editPort->setEnabled(true);
+        ui->comboBaud->setEnabled(true);
+        ui->comboFormat->setEnabled(true);
+        ui->spinSegment->setEnabled(true);
         ui->statusbar->showMessage("Measurement Done & File Written");
         return;
     }
     if(checkFileName()) {
         // Open the Output file
         ui->statusbar->showMessage("Opening Output file...");
+        sWriterError.clear();
+        startMeasuringTime = QDateTime::currentDateTime();
+        startMeasuringNs   = monotonicNSecs();
         if(!prepareOutputFile(sBaseDir, sOutFileName)) {
             ui->statusbar->showMessage("Unable to Open the Output file...");
             ui->buttonStart->setText("Start");
@@ -253,50 +566,303 @@ MainWindow::on_buttonStart_clicked() {
         pPlotMeasurements->UpdatePlot();
         ui->buttonStart->setText(QString("Stop"));
         ui->statusbar->showMessage("Measure in Progress...");
+        writerStatusTimer.start();
         ui->buttonPath->setDisabled(true);
         ui->editFileName->setDisabled(true);
         ui->editInfo->setDisabled(true);
-        startMeasuringTime = QDateTime::currentDateTime();
+        ui->editPort->setDisabled(true);
+        ui->comboBaud->setDisabled(true);
+        ui->comboFormat->setDisabled(true);
+        ui->spinSegment->setDisabled(true);
+        blockTimer.start();
+        tailTimer.start();
         bRunning = true;
     }
 }
 
 
+void
+MainWindow::on_buttonLoad_clicked() {
+    QString sFileName = QFileDialog::getOpenFileName(this,
+                                                     "Load Run",
+                                                     sBaseDir,
+                                                     "Data files (*.dat *.txt *.bin *.tpz *.idx);;All files (*)");
+    if(sFileName.isEmpty())
+        return;
+    QVector<double> x, y;
+    // The local event loop of parseTextRun() must not re-enter
+    // the window: only the acquisition goes on while loading
+    bLoading = true;
+    ui->buttonLoad->setDisabled(true);
+    ui->buttonStart->setDisabled(true);
+    bool bLoaded;
+    if(QFileInfo(sFileName).suffix() == "idx")
+        bLoaded = loadSegmentedRun(sFileName, x, y);
+    else
+        bLoaded = loadRun(sFileName, x, y);
+    ui->buttonLoad->setEnabled(true);
+    ui->buttonStart->setEnabled(true);
+    bLoading = false;
+    if(!bLoaded)
+        return;
+    if(!pPlotLoaded) {
+        pPlotLoaded = new Plot2D(nullptr, "Loaded Run");
+        pPlotLoaded->SetLimits(0.0, 1.0, 0.1, 1.0, true, true, false, false);
+        pPlotLoaded->NewDataSet(0,                   //Id
+                                3,                   //Pen Width
+                                QColor(208, 208, 255),// Color
+                                Plot2D::ipoint,      // Symbol
+                                "Loaded"             // Title
+                     );
+        pPlotLoaded->SetShowDataSet(0, true);
+        pPlotLoaded->SetShowTitle(0, true);
+    }
+    pPlotLoaded->setWindowTitle(QFileInfo(sFileName).fileName());
+    pPlotLoaded->ClearDataSet(0);
+    pPlotLoaded->NewPoints(0, x, y);
+    pPlotLoaded->UpdatePlot();
+    pPlotLoaded->show();
+    pPlotLoaded->raise();
+    ui->statusbar->showMessage(QString("%1 points loaded from %2")
+                               .arg(x.count())
+                               .arg(sFileName));
+}
+
+
+// Only the last hours of a segmented run are read: the index gives
+// the segment, and the offset in it, where they start.
 bool
-MainWindow::prepareOutputFile(QString sBaseDir, QString sFileName) {
-    if(pOutputFile) {
-        pOutputFile->close();
-        pOutputFile->deleteLater();
-        pOutputFile = Q_NULLPTR;
+MainWindow::loadSegmentedRun(QString sIndexFileName, QVector<double>& x, QVector<double>& y) {
+    SegmentIndex index;
+    if(!index.open(sIndexFileName) || index.entryCount() == 0) {
+        QMessageBox::critical(this, "Error: Unable to Load the Run",
+                              QString("%1\n%2").arg(sIndexFileName,
+                                                    index.entryCount() == 0 ? QString("Empty index")
+                                                                            : index.errorString()));
+        return false;
+    }
+    const double lastHours = index.lastTime()/3600.0;
+    bool bOk;
+    const double hours = QInputDialog::getDouble(this, "Load Run",
+                                                 QString("The run lasts %1 h at least.\n"
+                                                         "Hours to load, up to its end:")
+                                                 .arg(lastHours, 0, 'f', 1),
+                                                 qMin(2.0, qMax(0.1, lastHours)), 0.0, 1.0e6, 1, &bOk);
+    if(!bOk)
+        return false;
+    const double fromTime = index.lastTime() - hours*3600.0;
+    int segment = 0;
+    qint64 offset = 0;
+    index.locate(fromTime, segment, offset);
+    const QString sDataFileName = SegmentIndex::dataFileName(sIndexFileName);
+    for(; QFile::exists(SegmentIndex::segmentFileName(sDataFileName, segment)); segment++, offset=0) {
+        if(!loadRun(SegmentIndex::segmentFileName(sDataFileName, segment), x, y, fromTime, offset))
+            return false;
+    }
+    return true;
+}
+
+
+// Only the samples with a valid pressure, from fromTime on, are loaded.
+// The text files are read from offset (at a record boundary).
+bool
+MainWindow::loadRun(QString sFileName, QVector<double>& x, QVector<double>& y,
+                    double fromTime, qint64 offset)
+{
+    if(CompressedLogReader::isCompressedLog(sFileName)) {
+        CompressedLogReader reader;
+        QVector<double> times, pressures;
+        QVector<quint8> statuses;
+        if(!reader.open(sFileName) ||
+           !reader.decodeRange(fromTime,
+                               std::numeric_limits<double>::infinity(),
+                               times, pressures, statuses))
+        {
+            QMessageBox::critical(this, "Error: Unable to Load the Run",
+                                  QString("%1\n%2").arg(sFileName, reader.errorString()));
+            return false;
+        }
+        for(int i=0; i<times.count(); i++) {
+            if(statuses.at(i) > PressureSample::Overrange || times.at(i) < fromTime)
+                continue;
+            x.append(times.at(i));
+            y.append(pressures.at(i));
+        }
+        return true;
+    }
+    BinaryLogReader binaryReader;
+    if(binaryReader.open(sFileName)) {
+        x.reserve(int(binaryReader.sampleCount()));
+        y.reserve(int(binaryReader.sampleCount()));
+        for(int iBlock=0; iBlock<binaryReader.blockCount(); iBlock++) {
+            const BinaryLogReader::Block& block = binaryReader.block(iBlock);
+            if(block.count == 0 || block.pTime[block.count-1] < fromTime)
+                continue;
+            for(int i=0; i<block.count; i++) {
+                if(block.pStatus[i] > PressureSample::Overrange || block.pTime[i] < fromTime)
+                    continue;
+                x.append(block.pTime[i]);
+                y.append(block.pPressure[i]);
+            }
+        }
+        return true;
+    }
+    return parseTextRun(sFileName, x, y, fromTime, offset);
+}
+
+
+// The mapped file is parsed by all the cores while a local event
+// loop keeps the acquisition going (see on_buttonLoad_clicked()).
+bool
+MainWindow::parseTextRun(QString sFileName, QVector<double>& x, QVector<double>& y,
+                         double fromTime, qint64 offset)
+{
+    QFile file(sFileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        QMessageBox::critical(this, "Error: Unable to Load the Run",
+                              QString("%1\n%2").arg(sFileName, file.errorString()));
+        return false;
+    }
+    const qint64 size = file.size() - offset;
+    if(size <= 0)
+        return true;
+    const char* pData = reinterpret_cast<const char*>(file.map(offset, size));
+    if(!pData) {
+        QMessageBox::critical(this, "Error: Unable to Load the Run",
+                              QString("%1\n%2").arg(sFileName, file.errorString()));
+        return false;
+    }
+    // Chunks of about 8 MB, for a smooth progress bar
+    const int nChunks = int(qMax(qint64(QThread::idealThreadCount()), size >> 23));
+    QVector<TextRunParser::Chunk> chunks = TextRunParser::split(pData, size, nChunks);
+
+    QProgressDialog progressDialog(QString("Loading %1 ...").arg(QFileInfo(sFileName).fileName()),
+                                   "Cancel", 0, chunks.count(), this);
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.setMinimumDuration(500);
+    QFutureWatcher<void> watcher;
+    QEventLoop eventLoop;
+    connect(&watcher, SIGNAL(progressValueChanged(int)),
+            &progressDialog, SLOT(setValue(int)));
+    connect(&progressDialog, SIGNAL(canceled()),
+            &watcher, SLOT(cancel()));
+    connect(&watcher, SIGNAL(finished()),
+            &eventLoop, SLOT(quit()));
+    watcher.setFuture(QtConcurrent::map(chunks, TextRunParser::parse));
+    eventLoop.exec();
+    watcher.waitForFinished();
+    if(watcher.isCanceled()) {
+        ui->statusbar->showMessage("Loading canceled");
+        return false;
     }
-    pOutputFile = new QFile(sBaseDir + "/" + sFileName);
-    if(!pOutputFile->open(QIODevice::Text|QIODevice::WriteOnly)) {
+    const int nBefore = x.count();
+    TextRunParser::join(chunks, x, y);
+    // The records found at the offset can precede fromTime
+    int nEarlier = 0;
+    while(nBefore+nEarlier < x.count() && x.at(nBefore+nEarlier) < fromTime)
+        nEarlier++;
+    x.remove(nBefore, nEarlier);
+    y.remove(nBefore, nEarlier);
+    return true;
+}
+
+
+// A new port or baud rate takes effect at the next connection
+void
+MainWindow::on_editPort_editingFinished() {
+    if(ui->editPort->text() == sPortName)
+        return;
+    sPortName = ui->editPort->text();
+    pTgp261->setSerialPort(sPortName, baudRate);
+    ui->buttonStart->setText("Connect");
+}
+
+
+void
+MainWindow::on_comboBaud_activated(int index) {
+    if(ui->comboBaud->itemData(index).toInt() == baudRate)
+        return;
+    baudRate = ui->comboBaud->itemData(index).toInt();
+    pTgp261->setSerialPort(sPortName, baudRate);
+    ui->buttonStart->setText("Connect");
+}
+
+
+// The acquisition rate can be changed at any time
+void
+MainWindow::on_comboRate_activated(int index) {
+    acquisitionRate = ui->comboRate->itemData(index).toInt();
+    pTgp261->setAcquisitionRate(acquisitionRate);
+}
+
+
+void
+MainWindow::on_comboFormat_activated(int index) {
+    outputFormat = ui->comboFormat->itemData(index).toInt();
+}
+
+
+void
+MainWindow::on_spinSegment_valueChanged(int value) {
+    segmentMinutes = value;
+}
+
+
+bool
+MainWindow::prepareOutputFile(QString sBaseDir, QString sFileName) {
+    segment         = 0;
+    segmentBytes    = 0;
+    lastIndexedTime = -std::numeric_limits<double>::infinity();
+    QString sPath = sBaseDir + "/" + sFileName;
+    if(isSegmented())
+        sPath = SegmentIndex::segmentFileName(sPath, segment);
+    // The segments are written as they are (no "\r\n" on Windows),
+    // so that the offsets in the index are those in the files
+    if(!outputWriter.open(sPath, writerPolicy, outputFormat == TextFormat && !isSegmented())) {
         QMessageBox::critical(this,
                               "Error: Unable to Open Output File",
-                              QString("%1/%2")
-                              .arg(sBaseDir, sFileName));
+                              sPath);
         ui->statusbar->showMessage("Unable to Open Output file...");
         return false;
     }
+    if(isSegmented()) {
+        QString sIndexPath = SegmentIndex::indexFileName(sBaseDir + "/" + sFileName);
+        if(!indexWriter.open(sIndexPath, writerPolicy, false)) {
+            outputWriter.close();
+            QMessageBox::critical(this,
+                                  "Error: Unable to Open Index File",
+                                  sIndexPath);
+            ui->statusbar->showMessage("Unable to Open Index file...");
+            return false;
+        }
+        indexWriter.append(SegmentIndex::header(startMeasuringTime.toMSecsSinceEpoch()), 0);
+        segmentTimer.start();
+    }
     return true;
 }
 
 
 void
 MainWindow::writeFileHeader() {
-    // Write the header
-    // To cope with the GnuPlot way to handle the comment lines
-    // we need a # as a first chraracter in each row.
-    pOutputFile->write(QString("%1 %2\n")
-                       .arg("#Time[s]", 12)
-                       .arg("Pressure[mbar]", 12)
-                       .toLocal8Bit());
-
-    QStringList HeaderLines = ui->editInfo->toPlainText().split("\n");
-    for(int i=0; i<HeaderLines.count(); i++) {
-        pOutputFile->write("# ");
-        pOutputFile->write(HeaderLines.at(i).toLocal8Bit());
-        pOutputFile->write("\n");
-    }
-    pOutputFile->flush();
+    // Times are measured on the monotonic clock: this is the only
+    // place where they are tied to the wall clock.
+    QStringList commentLines;
+    commentLines.append(QString("Start: %1 (Time = 0 s)")
+                        .arg(startMeasuringTime.toString(Qt::ISODateWithMs)));
+    commentLines.append(QString("Gauge: %1 Units: %2")
+                        .arg(pTgp261->gaugeId(), pTgp261->units()));
+    if(isSegmented())
+        commentLines.append(QString("Segment: %1").arg(segment));
+    commentLines.append(ui->editInfo->toPlainText().split("\n"));
+    QByteArray header;
+    if(outputFormat == BinaryFormat)
+        header = BinaryLogEncoder::header(commentLines.join("\n"),
+                                          startMeasuringTime.toMSecsSinceEpoch());
+    else if(outputFormat == CompressedFormat)
+        header = CompressedLogEncoder::header(commentLines.join("\n"),
+                                              startMeasuringTime.toMSecsSinceEpoch());
+    else
+        header = TextRecordEncoder::header(commentLines);
+    appendOutput(header.constData(), header.size(), 0);
+    outputWriter.commit();
 }
@@ -3,10 +3,16 @@
 #include <QMainWindow>
 #include <QSettings>
 #include <QDateTime>
-#include <QFile>
+#include <QElapsedTimer>
+#include <limits>
 
 #include "tgp261.h"
 #include "plot2d.h"
+#include "outputwriter.h"
+#include "textrecord.h"
+#include "binarylog.h"
+#include "compressedlog.h"
+#include "segmentindex.h"
 
 
 QT_BEGIN_NAMESPACE
@@ -19,12 +25,22 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
+    enum OutputFormat {
+        TextFormat   = 0,
+        BinaryFormat = 1,
+        CompressedFormat = 2
+    };
+
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
     void show();
 
 public slots:
-    void onNewData(QString sData);
+    void onSamplesAvailable();
+    void onConnectionError(QString sError, QString sDevice);
+    void onWarning(QString sMessage);
+    void onWriterError(QString sError);
+    void onTgp261Initialized();
 
 protected:
     void closeEvent(QCloseEvent*) Q_DECL_OVERRIDE;
@@ -33,22 +49,69 @@ protected:
     bool checkFileName();
     bool prepareOutputFile(QString sBaseDir, QString sFileName);
     void writeFileHeader();
+    void processSample(const PressureSample& sample);
+    void showWriterStatus();
+    void writeBlock();
+    void writeTail();
+    void appendOutput(const char* pData, int nBytes, int nRecords);
+    bool isSegmented() const;
+    QString outputFileName() const;
+    void addIndexEntry(double time, qint64 offset);
+    void rotateSegment();
+    QString journalFileName() const;
+    void recoverJournal();
+    bool loadSegmentedRun(QString sIndexFileName, QVector<double>& x, QVector<double>& y);
+    bool loadRun(QString sFileName, QVector<double>& x, QVector<double>& y,
+                 double fromTime = -std::numeric_limits<double>::infinity(), qint64 offset = 0);
+    bool parseTextRun(QString sFileName, QVector<double>& x, QVector<double>& y,
+                      double fromTime, qint64 offset);
 
 private slots:
     void on_buttonPath_clicked();
     void on_buttonStart_clicked();
+    void on_buttonLoad_clicked();
+    void on_editPort_editingFinished();
+    void on_comboBaud_activated(int index);
+    void on_comboRate_activated(int index);
+    void on_comboFormat_activated(int index);
+    void on_spinSegment_valueChanged(int value);
 
 private:
     Ui::MainWindow *ui;
     QSettings    settings;
     tgp261*      pTgp261;
-    QFile*       pOutputFile;
+    OutputWriter outputWriter;
+    OutputWriter::Policy writerPolicy;
+    TextRecordEncoder textEncoder;
+    BinaryLogEncoder binaryEncoder;
+    CompressedLogEncoder compressedEncoder;
+    QElapsedTimer blockTimer;
+    QElapsedTimer tailTimer;
+    double       blockFirstTime;
+    OutputWriter indexWriter;
+    int          segment;
+    qint64       segmentBytes;     // Handed to outputWriter for the current segment
+    QElapsedTimer segmentTimer;
+    double       lastIndexedTime;
+    QElapsedTimer writerStatusTimer;
+    QString      sWriterError;     // The last one of this acquisition
     Plot2D*      pPlotMeasurements;
-    QDateTime    currentTime;
-    QDateTime    startMeasuringTime;
+    Plot2D*      pPlotLoaded;
+    QDateTime    startMeasuringTime; // Wall clock anchor of startMeasuringNs
+    qint64       startMeasuringNs;   // Monotonic clock origin of the time axis
     QDateTime    dateStart;
     QString      sSampleInfo;
     QString      sBaseDir;
     QString      sOutFileName;
+    QString      sPortName;
+    int          baudRate;
+    int          acquisitionRate;
+    int          outputFormat;
+    int          compressedChunkMs;
+    int          segmentMinutes;   // 0: no rotation by time
+    qint64       segmentMaxBytes;  // 0: no rotation by size
+    bool         bJournal;
     bool         bRunning;
+    bool         bLoading;         // A run is being loaded
+    int          lastGaugeStatus;
 };
@@ -0,0 +1,357 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include "outputwriter.h"
+
+#include <QElapsedTimer>
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#endif
+
+
+static const int bufferCapacity = 1 << 20;
+static const qint64 journalCheckpointBytes = 16 << 20;
+
+
+OutputWriter::Policy::Policy()
+    : flushRecords(100)
+    , flushMs(1000)
+    , bSync(false)
+    , preallocateBytes(0)
+{
+}
+
+
+OutputWriter::OutputWriter(QObject *parent)
+    : QThread(parent)
+    , bTextFile(true)
+    , bNewTail(false)
+    , tailOffset(-1)
+    , pendingRecords(0)
+    , bCommitRequested(false)
+    , bStop(false)
+    , nQueuedBytes(0)
+    , lastLatencyUs(0)
+    , maxLatencyUs(0)
+{
+    fillingBuffer.reserve(bufferCapacity);
+    writingBuffer.reserve(bufferCapacity);
+}
+
+
+OutputWriter::~OutputWriter() {
+    close();
+}
+
+
+// The journal is used by the following open() calls:
+// an empty name disables it.
+void
+OutputWriter::setJournal(QString sJournalFileName) {
+    this->sJournalFileName = sJournalFileName;
+}
+
+
+bool
+OutputWriter::open(QString sFileName, Policy newPolicy, bool bText) {
+    close();
+    policy    = newPolicy;
+    bTextFile = bText;
+    if(!openFile(sFileName))
+        return false;
+    if(!sJournalFileName.isEmpty()) {
+        if(journal.open(sJournalFileName)) {
+            journal.appendOpen(file.fileName(), bTextFile);
+            journal.commit(true);
+        }
+        else
+            emit writeError(QString("Unable to open the journal %1")
+                            .arg(sJournalFileName));
+    }
+    bStop            = false;
+    bCommitRequested = false;
+    pendingRecords   = 0;
+    bNewTail         = false;
+    tailOffset       = -1;
+    lastLatencyUs    = 0;
+    maxLatencyUs     = 0;
+    fillingRotations.clear();
+    fillingTail.resize(0);
+    start();
+    return true;
+}
+
+
+bool
+OutputWriter::openFile(QString sFileName) {
+    file.setFileName(sFileName);
+    QIODevice::OpenMode mode = QIODevice::WriteOnly;
+    if(bTextFile)
+        mode |= QIODevice::Text;
+    if(!file.open(mode)) {
+        sError = file.errorString();
+        return false;
+    }
+#if defined(Q_OS_LINUX)
+    // Reserve the blocks without changing the file size:
+    // a failure (e.g. on NFS) is not an error
+    if(policy.preallocateBytes > 0)
+        fallocate(file.handle(), FALLOC_FL_KEEP_SIZE, 0, policy.preallocateBytes);
+#endif
+    return true;
+}
+
+
+void
+OutputWriter::append(const char* pData, int nBytes, int nRecords) {
+    QMutexLocker locker(&mutex);
+    fillingBuffer.append(pData, nBytes);
+    nQueuedBytes = fillingBuffer.size();
+    const bool bWasIdle = (pendingRecords == 0 && !bNewTail);
+    pendingRecords += nRecords;
+    // The data supersede the tail not yet written
+    fillingTail.resize(0);
+    bNewTail = false;
+    // Wake the writer to arm its timer or to commit a full group
+    if((bWasIdle && nRecords > 0) ||
+       (policy.flushRecords > 0 && pendingRecords >= policy.flushRecords))
+        bufferReady.wakeOne();
+}
+
+
+void
+OutputWriter::append(const QByteArray& data, int nRecords) {
+    append(data.constData(), data.size(), nRecords);
+}
+
+
+// Replaces the tail: only the last one set before a commit is written
+void
+OutputWriter::setTail(const char* pData, int nBytes) {
+    QMutexLocker locker(&mutex);
+    fillingTail.resize(0);
+    fillingTail.append(pData, nBytes);
+    if(pendingRecords == 0 && !bNewTail)
+        bufferReady.wakeOne(); // To arm the writer timer
+    bNewTail = true;
+}
+
+
+void
+OutputWriter::setTail(const QByteArray& tail) {
+    setTail(tail.constData(), tail.size());
+}
+
+
+// Asks for an immediate commit of everything appended so far
+void
+OutputWriter::commit() {
+    QMutexLocker locker(&mutex);
+    bCommitRequested = true;
+    bufferReady.wakeOne();
+}
+
+
+// What is appended from now on goes to sNextFileName: the current
+// file is committed and closed by the writer thread.
+void
+OutputWriter::rotate(QString sNextFileName) {
+    QMutexLocker locker(&mutex);
+    Rotation rotation;
+    rotation.offset    = fillingBuffer.size();
+    rotation.sFileName = sNextFileName;
+    fillingRotations.append(rotation);
+    bCommitRequested = true;
+    bufferReady.wakeOne();
+}
+
+
+// Writes out everything still queued and closes the file
+void
+OutputWriter::close() {
+    if(isRunning()) {
+        mutex.lock();
+        bStop = true;
+        bufferReady.wakeOne();
+        mutex.unlock();
+        wait();
+    }
+    if(file.isOpen()) {
+        // The journal is no more needed once the file is on disk
+        if(journal.isOpen()) {
+            syncToDisk(file);
+            journal.remove();
+        }
+        file.close();
+    }
+}
+
+
+bool
+OutputWriter::isOpen() {
+    return isRunning();
+}
+
+
+QString
+OutputWriter::errorString() {
+    return sError;
+}
+
+
+int
+OutputWriter::queuedBytes() {
+    return nQueuedBytes;
+}
+
+
+qint64
+OutputWriter::lastWriteLatencyUs() {
+    return lastLatencyUs;
+}
+
+
+qint64
+OutputWriter::maxWriteLatencyUs() {
+    return maxLatencyUs;
+}
+
+
+void
+OutputWriter::run() {
+    QElapsedTimer sinceCommit;
+    sinceCommit.start();
+    mutex.lock();
+    forever {
+        const bool bPending = pendingRecords > 0 || bNewTail;
+        bool bTimeToCommit = bStop || bCommitRequested ||
+                             (policy.flushRecords > 0 && pendingRecords >= policy.flushRecords) ||
+                             (bPending && sinceCommit.elapsed() >= policy.flushMs);
+        if(!bTimeToCommit) {
+            if(!bPending) {
+                bufferReady.wait(&mutex);
+                sinceCommit.restart();
+            }
+            else {
+                qint64 waitMs = policy.flushMs - sinceCommit.elapsed();
+                bufferReady.wait(&mutex, ulong(qMax(qint64(1), waitMs)));
+            }
+            continue;
+        }
+        // Take the filled buffer and give the (empty) other one to the producer
+        fillingBuffer.swap(writingBuffer);
+        fillingRotations.swap(writingRotations);
+        fillingTail.swap(writingTail);
+        const bool bTail = bNewTail;
+        nQueuedBytes     = 0;
+        pendingRecords   = 0;
+        bNewTail         = false;
+        bCommitRequested = false;
+        const bool bLast = bStop;
+        mutex.unlock();
+
+        writeBuffer(writingBuffer, writingRotations, bTail);
+        writingRotations.resize(0);
+        sinceCommit.restart();
+        if(bLast)
+            return;
+        mutex.lock();
+    }
+}
+
+
+void
+OutputWriter::writeBuffer(QByteArray& buffer, const QVector<Rotation>& rotations, bool bTail) {
+    QElapsedTimer latency;
+    latency.start();
+    int start = 0;
+    // The tail of the previous commit is replaced by the new data
+    // (or by the new tail), that also hold its records
+    const bool bDropTail = tailOffset >= 0 && (bTail || !buffer.isEmpty() || !rotations.isEmpty());
+    if(journal.isOpen()) {
+        if(bDropTail)
+            journal.appendCheckpoint(file.fileName(), tailOffset, bTextFile);
+        for(int i=0; i<rotations.count(); i++) {
+            journal.appendData(buffer.constData()+start, rotations.at(i).offset-start);
+            journal.appendOpen(rotations.at(i).sFileName, bTextFile);
+            start = rotations.at(i).offset;
+        }
+        journal.appendData(buffer.constData()+start, buffer.size()-start);
+        if(bTail)
+            journal.appendData(writingTail.constData(), writingTail.size());
+        journal.commit(policy.bSync);
+        start = 0;
+    }
+    if(bDropTail && file.isOpen()) {
+        file.resize(tailOffset);
+        file.seek(tailOffset);
+        tailOffset = -1;
+    }
+    for(int i=0; i<rotations.count(); i++) {
+        writeData(buffer.constData()+start, rotations.at(i).offset-start);
+        start = rotations.at(i).offset;
+        if(journal.isOpen())
+            syncToDisk(file); // Before the journal forgets it
+        file.close();
+        if(!openFile(rotations.at(i).sFileName))
+            emit writeError(QString("Error opening %1: %2")
+                            .arg(rotations.at(i).sFileName, sError));
+    }
+    writeData(buffer.constData()+start, buffer.size()-start);
+    buffer.resize(0); // Keeps the reserved capacity
+    if(bTail && !writingTail.isEmpty() && file.isOpen()) {
+        tailOffset = file.pos();
+        writeData(writingTail.constData(), writingTail.size());
+    }
+    if(journal.size() >= journalCheckpointBytes)
+        checkpoint();
+    const qint64 us = latency.nsecsElapsed()/1000;
+    lastLatencyUs = us;
+    if(us > maxLatencyUs)
+        maxLatencyUs = us;
+}
+
+
+void
+OutputWriter::writeData(const char* pData, int nBytes) {
+    if(!file.isOpen())
+        return;
+    if(nBytes > 0 && file.write(pData, nBytes) != nBytes)
+        emit writeError(QString("Error writing %1: %2")
+                        .arg(file.fileName(), file.errorString()));
+    if(policy.bSync && !journal.isOpen())
+        syncToDisk(file);
+    else
+        file.flush();
+}
+
+
+// Once the file is on disk the journal restarts from its length
+void
+OutputWriter::checkpoint() {
+    syncToDisk(file);
+    journal.reset();
+    journal.appendCheckpoint(file.fileName(), file.size(), bTextFile);
+    journal.commit(true);
+}
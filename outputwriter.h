@@ -0,0 +1,115 @@
+// MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QFile>
+#include <QVector>
+#include <atomic>
+
+#include "journal.h"
+
+
+// Writes the acquisition file in a background thread.
+// The producer only copies its records into a preallocated buffer;
+// the writer thread swaps the buffers and writes them out in groups
+// ("group commit") according to the durability Policy: on a crash at
+// most flushRecords records or flushMs milliseconds are lost (without
+// bSync the data must still survive in the OS page cache).
+// With a Journal each group is journaled before being written and
+// only the journal is synced: see Journal.
+// A tail (e.g. the open chunk of a compressed file) can be written
+// after the appended data: it is committed as they are and it is
+// dropped from the file by the next data or the next tail.
+// The write errors are reported with the writeError() signal.
+class OutputWriter : public QThread
+{
+    Q_OBJECT
+public:
+    struct Policy {
+        Policy();
+        int    flushRecords;      // Commit every flushRecords (0: never by count)
+        int    flushMs;           // ...or at least every flushMs milliseconds
+        bool   bSync;             // fdatasync() (the journal) after each commit
+        qint64 preallocateBytes;  // Disk space to reserve at open
+    };
+
+    explicit OutputWriter(QObject *parent = nullptr);
+    ~OutputWriter();
+    void setJournal(QString sJournalFileName);
+    bool open(QString sFileName, Policy newPolicy, bool bText = true);
+    void append(const char* pData, int nBytes, int nRecords = 1);
+    void append(const QByteArray& data, int nRecords = 1);
+    void setTail(const char* pData, int nBytes);
+    void setTail(const QByteArray& tail);
+    void commit();
+    void rotate(QString sNextFileName);
+    void close();
+    bool isOpen();
+    QString errorString();
+    int    queuedBytes();
+    qint64 lastWriteLatencyUs();
+    qint64 maxWriteLatencyUs();
+
+signals:
+    void writeError(QString sError); // Also from the writer thread
+
+protected:
+    struct Rotation {
+        int     offset;    // Of the first byte of the next file
+        QString sFileName;
+    };
+
+    void run() Q_DECL_OVERRIDE;
+    bool openFile(QString sFileName);
+    void writeBuffer(QByteArray& buffer, const QVector<Rotation>& rotations, bool bTail);
+    void writeData(const char* pData, int nBytes);
+    void checkpoint();
+
+protected:
+    QFile          file;
+    Journal        journal;
+    QString        sJournalFileName;
+    Policy         policy;
+    bool           bTextFile;
+    QMutex         mutex;
+    QWaitCondition bufferReady;
+    QByteArray     fillingBuffer;  // Appended to by the producer
+    QByteArray     writingBuffer;  // Written by the writer thread
+    QVector<Rotation> fillingRotations;
+    QVector<Rotation> writingRotations;
+    QByteArray     fillingTail;
+    QByteArray     writingTail;
+    bool           bNewTail;       // fillingTail is still to be written
+    qint64         tailOffset;     // Of the tail in the file (-1: none)
+    int            pendingRecords;
+    bool           bCommitRequested;
+    bool           bStop;
+    QString        sError;
+    std::atomic<int>    nQueuedBytes;
+    std::atomic<qint64> lastLatencyUs;
+    std::atomic<qint64> maxLatencyUs;
+};
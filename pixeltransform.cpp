@@ -0,0 +1,155 @@
+/*
+ *
+Copyright (C) 2021  Gabriele Salvato
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+#include "pixeltransform.h"
+
+#include <climits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PIXELTRANSFORM_SSE2
+#endif
+
+
+// The reference expression, also used for the last values of the SIMD loops
+static void
+transformScalar(const AxisTransform& t,
+                const double* pValues, const double* pLogValues, int i, int n,
+                int* pPixels, quint8* pMask, bool bCombine)
+{
+    for(; i<n; i++) {
+        const double v = pValues[i];
+        if(t.bLog && !(v > 0.0))
+            pPixels[i] = -INT_MAX;
+        else
+            pPixels[i] = int(((t.bLog ? pLogValues[i] : v) - t.vMin)*t.factor + t.origin);
+        const quint8 inside = (v >= t.lo && v <= t.hi) ? 1 : 0;
+        pMask[i] = bCombine ? quint8(pMask[i] & inside) : inside;
+    }
+}
+
+
+// The points excluded on a log axis get -INT_MAX (exact as a double)
+// before the conversion, so that the same truncation applies to all.
+void
+transformAxis(const AxisTransform& t,
+              const double* pValues, const double* pLogValues, int n,
+              int* pPixels, quint8* pMask, bool bCombine)
+{
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256d vMin     = _mm256_set1_pd(t.vMin);
+    const __m256d factor   = _mm256_set1_pd(t.factor);
+    const __m256d origin   = _mm256_set1_pd(t.origin);
+    const __m256d lo       = _mm256_set1_pd(t.lo);
+    const __m256d hi       = _mm256_set1_pd(t.hi);
+    const __m256d zero     = _mm256_setzero_pd();
+    const __m256d excluded = _mm256_set1_pd(-double(INT_MAX));
+    for(; i+4<=n; i+=4) {
+        const __m256d v = _mm256_loadu_pd(pValues+i);
+        const __m256d w = t.bLog ? _mm256_loadu_pd(pLogValues+i) : v;
+        __m256d p = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(w, vMin), factor), origin);
+        if(t.bLog)
+            p = _mm256_blendv_pd(excluded, p, _mm256_cmp_pd(v, zero, _CMP_GT_OQ));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pPixels+i), _mm256_cvttpd_epi32(p));
+        const int inside = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(v, lo, _CMP_GE_OQ),
+                                                            _mm256_cmp_pd(v, hi, _CMP_LE_OQ)));
+        for(int k=0; k<4; k++) {
+            const quint8 bit = quint8((inside >> k) & 1);
+            pMask[i+k] = bCombine ? quint8(pMask[i+k] & bit) : bit;
+        }
+    }
+#elif defined(PIXELTRANSFORM_SSE2)
+    const __m128d vMin     = _mm_set1_pd(t.vMin);
+    const __m128d factor   = _mm_set1_pd(t.factor);
+    const __m128d origin   = _mm_set1_pd(t.origin);
+    const __m128d lo       = _mm_set1_pd(t.lo);
+    const __m128d hi       = _mm_set1_pd(t.hi);
+    const __m128d zero     = _mm_setzero_pd();
+    const __m128d excluded = _mm_set1_pd(-double(INT_MAX));
+    for(; i+2<=n; i+=2) {
+        const __m128d v = _mm_loadu_pd(pValues+i);
+        const __m128d w = t.bLog ? _mm_loadu_pd(pLogValues+i) : v;
+        __m128d p = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(w, vMin), factor), origin);
+        if(t.bLog) {
+            const __m128d positive = _mm_cmpgt_pd(v, zero);
+            p = _mm_or_pd(_mm_and_pd(positive, p), _mm_andnot_pd(positive, excluded));
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pPixels+i), _mm_cvttpd_epi32(p));
+        const int inside = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(v, lo),
+                                                      _mm_cmple_pd(v, hi)));
+        for(int k=0; k<2; k++) {
+            const quint8 bit = quint8((inside >> k) & 1);
+            pMask[i+k] = bCombine ? quint8(pMask[i+k] & bit) : bit;
+        }
+    }
+#endif
+    transformScalar(t, pValues, pLogValues, i, n, pPixels, pMask, bCombine);
+}
+
+
+// The polyline covers the same pixels with at most 4 points per column,
+// whatever the number of samples. The capacity of path is kept.
+void
+reduceM4(const int* pPixelX, const int* pPixelY, int n, int xMax,
+         QVector<QPoint>& path)
+{
+    path.clear();
+    int colX = -INT_MAX, nCol = 0;
+    int firstY = 0, lastY = 0, minY = 0, maxY = 0, iMinY = 0, iMaxY = 0;
+    auto flushColumn = [&]() {
+        if(nCol == 0) return;
+        path.append(QPoint(colX, firstY));
+        if(iMinY > 0 && iMinY < nCol-1 && iMinY < iMaxY)
+            path.append(QPoint(colX, minY));
+        if(iMaxY > 0 && iMaxY < nCol-1)
+            path.append(QPoint(colX, maxY));
+        if(iMinY > 0 && iMinY < nCol-1 && iMinY > iMaxY)
+            path.append(QPoint(colX, minY));
+        if(nCol > 1)
+            path.append(QPoint(colX, lastY));
+        nCol = 0;
+    };
+
+    for(int i=0; i<n; i++) {
+        const int ix = pPixelX[i];
+        const int iy = pPixelY[i];
+        if(ix == -INT_MAX || iy == -INT_MAX) {
+            flushColumn();
+            path.append(QPoint(ix, iy));
+        }
+        else if(nCol > 0 && ix == colX) {
+            if(iy < minY) { minY = iy; iMinY = nCol; }
+            if(iy > maxY) { maxY = iy; iMaxY = nCol; }
+            lastY = iy;
+            nCol++;
+        }
+        else {
+            flushColumn();
+            colX   = ix;
+            firstY = lastY = minY = maxY = iy;
+            iMinY  = iMaxY = 0;
+            nCol   = 1;
+        }
+        if(ix > xMax)
+            break;
+    }
+    flushColumn();
+}
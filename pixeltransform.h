@@ -0,0 +1,56 @@
+/*
+ *
+Copyright (C) 2021  Gabriele Salvato
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+#pragma once
+
+#include <QtGlobal>
+#include <QPoint>
+#include <QVector>
+
+
+// World to pixel mapping of one plot axis:
+//     pixel = int((value - vMin)*factor + origin)
+// On a log axis the values are the log10 of the coordinates and the
+// coordinates not positive map to -INT_MAX, to exclude the point.
+// The mask tells the coordinates in [lo, hi].
+struct AxisTransform
+{
+    double vMin;
+    double factor;
+    double origin;
+    double lo;
+    double hi;
+    bool   bLog;
+};
+
+
+// Transforms n coordinates (pLogValues is only read on a log axis).
+// With bCombine the mask is and-ed with the one already in pMask.
+// AVX2 or SSE2 when the compiler targets them, scalar otherwise:
+// all give the same pixels as the scalar expression.
+void transformAxis(const AxisTransform& t,
+                   const double* pValues, const double* pLogValues, int n,
+                   int* pPixels, quint8* pMask, bool bCombine);
+
+
+// M4 reduction of a polyline: of the consecutive points falling in the
+// same pixel column only the first, the minimum, the maximum and the
+// last are kept, in their order. The points excluded (-INT_MAX) are
+// kept as they are. The path stops at the first point beyond xMax.
+void reduceM4(const int* pPixelX, const int* pPixelY, int n, int xMax,
+              QVector<QPoint>& path);
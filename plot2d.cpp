@@ -26,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QCloseEvent>
 #include <QDebug>
 #include <QIcon>
+#include <QtConcurrent>
+#include <QtMath>
 
 
 Plot2D::Plot2D(QWidget *parent, QString Title)
@@ -45,10 +47,17 @@ Plot2D::Plot2D(QWidget *parent, QString Title)
     yMarker      = 0.0;
     bShowMarker  = false;
     bZooming     = false;
+    pHistoryData = nullptr;
+    historyFrom  = 0.0;
+    historyTo    = 0.0;
+    connect(&historyLoader, SIGNAL(finished()),
+            this, SLOT(update()));
 
     pPropertiesDlg = new plotPropertiesDlg(sTitle);
     connect(pPropertiesDlg, SIGNAL(configChanged()),
             this, SLOT(UpdatePlot()));
+    connect(pPropertiesDlg, SIGNAL(memoryBudgetChanged()),
+            this, SLOT(applyMemoryBudget()));
 
     labelPen = pPropertiesDlg->labelColor;//QPen(Qt::white);
     gridPen  = pPropertiesDlg->gridColor; //QPen(Qt::blue);
@@ -67,6 +76,7 @@ Plot2D::Plot2D(QWidget *parent, QString Title)
 Plot2D::~Plot2D() {
     QSettings settings;
     settings.setValue(sTitle+QString("Plot2D"), saveGeometry());
+    historyLoader.waitForFinished();
     while(!dataSetList.isEmpty()) {
         delete dataSetList.takeFirst();
     }
@@ -124,11 +134,14 @@ Plot2D::sizeHint() const {
 }
 
 
+// The budget of the properties dialog is for all the data sets
+// of the plot, shared in equal parts
 void
-Plot2D::setMaxPoints(int nPoints) {
-    if(nPoints > 0) pPropertiesDlg->maxDataPoints = nPoints;
+Plot2D::applyMemoryBudget() {
+    if(dataSetList.isEmpty()) return;
+    qint64 nBytes = qint64(pPropertiesDlg->memoryBudgetMB)*1024*1024;
     for(int pos=0; pos<dataSetList.count(); pos++) {
-        dataSetList.at(pos)->setMaxPoints(pPropertiesDlg->maxDataPoints);
+        dataSetList.at(pos)->setMemoryBudget(nBytes/dataSetList.count());
     }
 }
 
@@ -167,26 +180,34 @@ Plot2D::SetLimits (double XMin, double XMax, double YMin, double YMax,
                     YMax =-double(FLT_MAX);
                 }
             }
+            bool bVisibleY = false;
             DataStream2D* pData;
             for(int pos=0; pos<dataSetList.count(); pos++) {
                 pData = dataSetList.at(pos);
                 if(pData->isShown) {
-                    if(pData->m_pointArrayX.count() != 0) {
+                    std::shared_ptr<const DataSnapshot> pWindow = pData->snapshot();
+                    if(pWindow->count() != 0) {
                         EmptyData = false;
                         if(Ax.AutoX) {
-                            if(XMin > pData->minx) {
-                                XMin = pData->minx;
+                            if(XMin > pWindow->minx) {
+                                XMin = pWindow->minx;
                             }
-                            if(XMax < pData->maxx) {
-                                XMax = pData->maxx;
+                            if(XMax < pWindow->maxx) {
+                                XMax = pWindow->maxx;
                             }
                         }// if(Ax.AutoX)
                         if(Ax.AutoY) {
-                            if(YMin > pData->miny) {
-                                YMin = pData->miny;
-                            }
-                            if(YMax < pData->maxy) {
-                                YMax = pData->maxy;
+                            // With a fixed X range only the visible points count
+                            double ymin = pWindow->miny;
+                            double ymax = pWindow->maxy;
+                            if(Ax.AutoX || pData->yLimits(*pWindow, XMin, XMax, ymin, ymax)) {
+                                bVisibleY = true;
+                                if(YMin > ymin) {
+                                    YMin = ymin;
+                                }
+                                if(YMax < ymax) {
+                                    YMax = ymax;
+                                }
                             }
                         }// if(Ax.AutoY)
                     }// if(pData->m_pointArray.GetSize() != 0)
@@ -198,6 +219,10 @@ Plot2D::SetLimits (double XMin, double XMax, double YMin, double YMax,
                 YMin = Ax.YMin;
                 YMax = Ax.YMax;
             }
+            else if(Ax.AutoY && !bVisibleY) {
+                YMin = Ax.YMin;
+                YMax = Ax.YMax;
+            }
         }
     }
     if(abs(XMin-XMax) < double(FLT_MIN)) {
@@ -236,8 +261,8 @@ Plot2D::SetLimits (double XMin, double XMax, double YMin, double YMax,
 DataStream2D*
 Plot2D::NewDataSet(int Id, int PenWidth, QColor Color, int Symbol, QString Title) {
     DataStream2D* pDataItem = new DataStream2D(Id, PenWidth, Color, Symbol, Title);
-    pDataItem->setMaxPoints(pPropertiesDlg->maxDataPoints);
     dataSetList.append(pDataItem);
+    applyMemoryBudget();
     return pDataItem;
 }
 
@@ -270,6 +295,9 @@ Plot2D::SetShowDataSet(int Id, bool Show) {
 }
 
 
+// Once the data sets exist the points can be added by another thread:
+// the drawing only uses the published snapshots. The points are drawn
+// after the next PublishPoints().
 void
 Plot2D::NewPoint(int Id, double x, double y) {
     if(std::isnan(y)) return;
@@ -287,6 +315,25 @@ Plot2D::NewPoint(int Id, double x, double y) {
 }
 
 
+void
+Plot2D::NewPoints(int Id, const QVector<double>& x, const QVector<double>& y) {
+    for(int pos=0; pos<dataSetList.count(); pos++) {
+        if(dataSetList.at(pos)->GetId() == Id) {
+            dataSetList.at(pos)->AddPoints(x.constData(), y.constData(), qMin(x.count(), y.count()));
+            break;
+        }
+    }
+}
+
+
+// Called by the thread adding the points, once for each batch
+void
+Plot2D::PublishPoints() {
+    for(int pos=0; pos<dataSetList.count(); pos++)
+        dataSetList.at(pos)->publish();
+}
+
+
 void
 Plot2D::DrawData(QPainter* painter, QFontMetrics fontMetrics) {
     if(dataSetList.isEmpty()) return;
@@ -294,12 +341,16 @@ Plot2D::DrawData(QPainter* painter, QFontMetrics fontMetrics) {
     for(int pos=0; pos<dataSetList.count(); pos++) {
         pData = dataSetList.at(pos);
         if(pData->isShown) {
+            // New points may be added meanwhile
+            std::shared_ptr<const DataSnapshot> pWindow = pData->snapshot();
+            if(pData->hasHistory())
+                HistoryPlot(painter, pData, *pWindow);
             if(pData->GetProperties().Symbol == iline) {
-                LinePlot(painter, pData);
+                LinePlot(painter, pData, *pWindow);
             } else if(pData->GetProperties().Symbol == ipoint) {
-                PointPlot(painter, pData);
+                PointPlot(painter, pData, *pWindow);
             } else {
-                ScatterPlot(painter, pData);
+                ScatterPlot(painter, pData, *pWindow);
             }
             if(pData->bShowCurveTitle) ShowTitle(painter, fontMetrics, pData);
         }
@@ -666,215 +717,340 @@ Plot2D::DrawPlot(QPainter* painter, QFontMetrics fontMetrics) {
 }
 
 
-void
-Plot2D::LinePlot(QPainter* painter, DataStream2D* pData) {
-    if(!pData->isShown) return;
-    int iMax = int(pData->m_pointArrayX.count());
-    if(iMax == 0) return;
-    QPen dataPen = QPen(pData->GetProperties().Color);
-    dataPen.setWidth(pData->GetProperties().PenWidth);
-    painter->setPen(dataPen);
-    int ix0, iy0, ix1, iy1;
-    double xlmin, ylmin;
-    if(Ax.XMin > 0.0)
-        xlmin = log10(Ax.XMin);
+// The world to pixel mapping of the axes, as in the scale drawing
+AxisTransform
+Plot2D::XTransform() const {
+    AxisTransform t;
+    t.bLog = Ax.LogX;
+    if(Ax.LogX)
+        t.vMin = Ax.XMin > 0.0 ? log10(Ax.XMin) : double(FLT_MIN);
+    else
+        t.vMin = Ax.XMin;
+    t.factor = xfact;
+    t.origin = Pf.left;
+    t.lo     = Ax.XMin;
+    t.hi     = Ax.XMax;
+    return t;
+}
+
+
+AxisTransform
+Plot2D::YTransform() const {
+    AxisTransform t;
+    t.bLog = Ax.LogY;
+    if(Ax.LogY)
+        t.vMin = Ax.YMin > 0.0 ? log10(Ax.YMin) : double(FLT_MIN);
     else
-        xlmin = double(FLT_MIN);
-    if(Ax.YMin > 0.0)
-        ylmin = log10(Ax.YMin);
-    else ylmin = double(FLT_MIN);
+        t.vMin = Ax.YMin;
+    t.factor = yfact;
+    t.origin = Pf.bottom;
+    t.lo     = Ax.YMin;
+    t.hi     = Ax.YMax;
+    return t;
+}
 
-    if(Ax.LogX) {
-        if(pData->m_pointArrayX[0] > 0.0)
-            ix0 = int((Pf.left + (log10(pData->m_pointArrayX[0]) - xlmin)*xfact));
-        else
-            ix0 =-INT_MAX; // Solo per escludere il punto
-    } else
-        ix0 = int((Pf.left + (pData->m_pointArrayX[0] - Ax.XMin)*xfact));
 
-    if(Ax.LogY) {
-        if(pData->m_pointArrayY[0] > 0.0)
-            iy0 = int((Pf.bottom + (log10(pData->m_pointArrayY[0]) - ylmin)*yfact));
-        else
-            iy0 =-INT_MAX; // Solo per escludere il punto
-    } else
-        iy0 = int((Pf.bottom + (pData->m_pointArrayY[0] - Ax.YMin)*yfact));
+// Maps the points [first, last) of the window into pixelX, pixelY
+// (-INT_MAX for the points excluded on log axes) and pixelMask (the
+// point is inside the axes limits), one chunk span at a time.
+int
+Plot2D::TransformPoints(const DataSnapshot& window, int first, int last) {
+    const int n = last-first;
+    if(pixelX.count() < n) {
+        pixelX.resize(n);
+        pixelY.resize(n);
+        pixelMask.resize(n);
+    }
+    const AxisTransform tx = XTransform();
+    const AxisTransform ty = YTransform();
+    const DataChunk* pChunk;
+    int slot;
+    for(int i=first; i<last; ) {
+        const int nSpan = window.span(i, last, pChunk, slot);
+        transformAxis(tx, pChunk->x+slot, pChunk->logX+slot, nSpan,
+                      pixelX.data()+(i-first), pixelMask.data()+(i-first), false);
+        transformAxis(ty, pChunk->y+slot, pChunk->logY+slot, nSpan,
+                      pixelY.data()+(i-first), pixelMask.data()+(i-first), true);
+        i += nSpan;
+    }
+    return n;
+}
 
-    for(int i=1; i<iMax; i++) {
-        if(Ax.LogX)
-            ix1 = int(((log10(pData->m_pointArrayX[i]) - xlmin)*xfact) + Pf.left);
-        else
-            ix1 = int(((pData->m_pointArrayX[i] - Ax.XMin)*xfact) + Pf.left);
-        if(Ax.LogY)
-            if(pData->m_pointArrayY[i] > 0.0)
-                iy1 = int((Pf.bottom + (log10(pData->m_pointArrayY[i]) - ylmin)*yfact));
-            else
-                iy1 =-INT_MAX; // Solo per escludere il punto
-        else
-            iy1 = int((Pf.bottom + (pData->m_pointArrayY[i] - Ax.YMin)*yfact));
 
-        if(!(ix1<Pf.left || iy1<Pf.top || iy1>Pf.bottom)) {
-            painter->drawLine(ix0, iy0, ix1, iy1);
+void
+Plot2D::LinePlot(QPainter* painter, DataStream2D* pData, const DataSnapshot& window) {
+    if(!pData->isShown) return;
+    int iFirst, iMax;
+    window.range(Ax.XMin, Ax.XMax, iFirst, iMax);
+    if(iFirst == iMax) return;
+    QPen dataPen = QPen(pData->GetProperties().Color);
+    dataPen.setWidth(pData->GetProperties().PenWidth);
+    painter->setPen(dataPen);
+    const int n = TransformPoints(window, iFirst, iMax);
+    QVector<QPoint>& path = pointBuffer;
+    reduceM4(pixelX.constData(), pixelY.constData(), n, int(Pf.right), path);
+
+    // A segment is drawn when its end point is inside the frame:
+    // the runs of consecutive segments drawn go out as polylines
+    int iRun = 0;
+    for(int i=1; i<=path.count(); i++) {
+        bool bDrawn = false;
+        if(i < path.count()) {
+            const QPoint& p1 = path.at(i);
+            bDrawn = !(p1.x()<Pf.left || p1.y()<Pf.top || p1.y()>Pf.bottom);
         }
-        ix0 = ix1;
-        iy0 = iy1;
-        if(ix1 > Pf.right) {
-            break;
+        if(!bDrawn) {
+            if(i-iRun > 1)
+                painter->drawPolyline(path.constData()+iRun, i-iRun);
+            iRun = i;
         }
     }
-    DrawLastPoint(painter, pData);
+    DrawLastPoint(painter, pData, window);
 }
 
 
 void
-Plot2D::DrawLastPoint(QPainter* painter, DataStream2D* pData) {
+Plot2D::DrawLastPoint(QPainter* painter, DataStream2D* pData, const DataSnapshot& window) {
     if(!pData->isShown) return;
     int ix, iy, i;
-    i = int(pData->m_pointArrayX.count()-1);
-
-    double xlmin, ylmin;
-    if(Ax.XMin > 0.0)
-        xlmin = log10(Ax.XMin);
-    else
-        xlmin = double(FLT_MIN);
-    if(Ax.YMin > 0.0)
-        ylmin = log10(Ax.YMin);
-    else ylmin = double(FLT_MIN);
-
-    if(Ax.LogX) {
-        if(pData->m_pointArrayX[i] > 0.0)
-            ix = int(((log10(pData->m_pointArrayX[i]) - xlmin)*xfact) + Pf.left);
-        else
-            return;
-    } else {
-        ix = int(((pData->m_pointArrayX[i] - Ax.XMin)*xfact) + Pf.left);
-    }
-    if(Ax.LogY) {
-        if(pData->m_pointArrayY[i] > 0.0)
-            iy = int((Pf.bottom + (log10(pData->m_pointArrayY[i]) - ylmin)*yfact));
-        else
-            return;
-    }
-    else {
-        iy = int((Pf.bottom + (pData->m_pointArrayY[i] - Ax.YMin)*yfact));
-    }
+    i = window.count()-1;
+    if(i < 0) return;
+    TransformPoints(window, i, i+1);
+    ix = pixelX.at(0);
+    iy = pixelY.at(0);
     if(ix<=Pf.right && ix>=Pf.left && iy>=Pf.top && iy<=Pf.bottom)
         painter->drawPoint(ix, iy);
     return;
 }
 
 
+// Maps the buckets column by column, as TransformPoints() does for the
+// window: historyPixels holds the n pixels x, then the n yMin, yMax,
+// yFirst and yLast. The buckets carry no log10: they are taken here,
+// for about one bucket per pixel.
+void
+Plot2D::TransformHistory(const QVector<LodBucket>& buckets) {
+    const int n = buckets.count();
+    historyValues.resize(5*n);
+    historyLogValues.resize(5*n);
+    historyPixels.resize(5*n);
+    historyMask.resize(5*n);
+    double* pValues = historyValues.data();
+    for(int i=0; i<n; i++) {
+        const LodBucket& bucket = buckets.at(i);
+        pValues[i]     = 0.5*(bucket.xFirst+bucket.xLast);
+        pValues[n+i]   = bucket.yMin;
+        pValues[2*n+i] = bucket.yMax;
+        pValues[3*n+i] = bucket.yFirst;
+        pValues[4*n+i] = bucket.yLast;
+    }
+    if(Ax.LogX)
+        for(int i=0; i<n; i++)
+            historyLogValues[i] = log10(pValues[i]);
+    if(Ax.LogY)
+        for(int i=n; i<5*n; i++)
+            historyLogValues[i] = log10(pValues[i]);
+    transformAxis(XTransform(), pValues, historyLogValues.constData(), n,
+                  historyPixels.data(), historyMask.data(), false);
+    transformAxis(YTransform(), pValues+n, historyLogValues.constData()+n, 4*n,
+                  historyPixels.data()+n, historyMask.data()+n, false);
+}
+
+
+// The part of the run no longer in the points window is drawn from the
+// pyramid at about one bucket per pixel: each bucket is a vertical bar
+// from its minimum to its maximum, joined to the next one for lines.
+// When zoomed in enough the samples of the sample store are drawn
+// (one bucket each); those on disk are read back by a worker thread,
+// the pyramid is drawn meanwhile.
 void
-Plot2D::PointPlot(QPainter* painter, DataStream2D* pData) {
-    int iMax = int(pData->m_pointArrayX.count());
-    if(iMax == 0) return;
+Plot2D::HistoryPlot(QPainter* painter, DataStream2D* pData, const DataSnapshot& window) {
+    QVector<LodBucket>& buckets = historyBuckets;
+    const int nPixels = qMax(1, int(Pf.right-Pf.left));
+    QVector<double>& x = historyX;
+    QVector<double>& y = historyY;
+    bool bSamples = false;
+    // The count is by whole pages: the two at the ends may be partly out
+    if(pData->historyCount(Ax.XMin, Ax.XMax) <= 2*nPixels+2*SampleStore::pageSamples) {
+        bSamples = pData->readHistory(Ax.XMin, Ax.XMax, x, y);
+        if(!bSamples)
+            LoadHistory(pData, Ax.XMin, Ax.XMax);
+    }
+    if(bSamples) {
+        buckets.clear();
+        for(int i=0; i<x.count(); i++) {
+            const LodBucket sample = {x.at(i), x.at(i), y.at(i), y.at(i), y.at(i), y.at(i)};
+            buckets.append(sample);
+        }
+    }
+    else
+        pData->selectHistory(Ax.XMin, Ax.XMax, nPixels, buckets);
+    if(buckets.isEmpty()) return;
     QPen dataPen = QPen(pData->GetProperties().Color);
     dataPen.setWidth(pData->GetProperties().PenWidth);
     painter->setPen(dataPen);
-    int ix, iy;
-    double xlmin, ylmin;
-    if(Ax.XMin > 0.0)
-        xlmin = log10(Ax.XMin);
-    else
-        xlmin = double(FLT_MIN);
-    if(Ax.YMin > 0.0)
-        ylmin = log10(Ax.YMin);
-    else ylmin = double(FLT_MIN);
-
-    for (int i=0; i < iMax; i++) {
-        if(!(pData->m_pointArrayX[i] < Ax.XMin ||
-             pData->m_pointArrayX[i] > Ax.XMax ||
-             pData->m_pointArrayY[i] < Ax.YMin ||
-             pData->m_pointArrayY[i] > Ax.YMax ))
-        {
-            if(Ax.LogX) {
-                if(pData->m_pointArrayX[i] > 0.0)
-                    ix = int(((log10(pData->m_pointArrayX[i]) - xlmin)*xfact) + Pf.left);
-                else
-                    ix = -INT_MAX;
-            } else
-                ix = int(((pData->m_pointArrayX[i] - Ax.XMin)*xfact) + Pf.left);
-            if(Ax.LogY) {
-                if(pData->m_pointArrayY[i] > 0.0)
-                    iy = int((Pf.bottom + (log10(pData->m_pointArrayY[i]) - ylmin)*yfact));
-                else
-                    iy =-INT_MAX; // Solo per escludere il punto
-            } else
-                iy = int((Pf.bottom + (pData->m_pointArrayY[i] - Ax.YMin)*yfact));
-            painter->drawPoint(ix, iy);
+    const bool bJoin = pData->GetProperties().Symbol == iline;
+    const int top    = int(Pf.top);
+    const int bottom = int(Pf.bottom);
+    int ix0 = -INT_MAX, iy0 = -INT_MAX;
+    lineBuffer.clear();
+    pointBuffer.clear();
+    TransformHistory(buckets);
+    const int n = buckets.count();
+    const int* pX     = historyPixels.constData();
+    const int* pMin   = pX + n;
+    const int* pMax   = pX + 2*n;
+    const int* pFirst = pX + 3*n;
+    const int* pLast  = pX + 4*n;
+    for(int i=0; i<n; i++) {
+        int ix  = pX[i];
+        int iy1 = pMin[i];
+        int iy2 = pMax[i];
+        if(ix < Pf.left || ix > Pf.right || iy1 == -INT_MAX || iy2 == -INT_MAX) {
+            ix0 = -INT_MAX;
+            continue;
         }
-    }//for (int i=0; i <= iMax; i++)
+        if(bJoin && ix0 != -INT_MAX) {
+            int iy = pFirst[i];
+            if(iy >= top && iy <= bottom && iy0 >= top && iy0 <= bottom)
+                lineBuffer.append(QLine(ix0, iy0, ix, iy));
+        }
+        iy1 = qBound(top, iy1, bottom);
+        iy2 = qBound(top, iy2, bottom);
+        if(iy1 == iy2)
+            pointBuffer.append(QPoint(ix, iy1));
+        else
+            lineBuffer.append(QLine(ix, iy1, ix, iy2));
+        ix0 = ix;
+        iy0 = pLast[i];
+    }
+    // Joined to the first point of the window
+    if(bJoin && ix0 != -INT_MAX && window.count() > 0) {
+        TransformPoints(window, 0, 1);
+        int ix = pixelX.at(0);
+        int iy = pixelY.at(0);
+        if(ix >= Pf.left && ix <= Pf.right &&
+           iy >= top && iy <= bottom && iy0 >= top && iy0 <= bottom)
+            lineBuffer.append(QLine(ix0, iy0, ix, iy));
+    }
+    painter->drawLines(lineBuffer.constData(), lineBuffer.count());
+    painter->drawPoints(pointBuffer.constData(), pointBuffer.count());
+}
+
+
+// One range at a time, and only once for the same range:
+// the plot is redrawn when the samples are in memory.
+void
+Plot2D::LoadHistory(DataStream2D* pData, double xFrom, double xTo) {
+    if(historyLoader.isRunning() ||
+       (pData == pHistoryData && xFrom == historyFrom && xTo == historyTo))
+        return;
+    pHistoryData = pData;
+    historyFrom  = xFrom;
+    historyTo    = xTo;
+    historyLoader.setFuture(QtConcurrent::run([pData, xFrom, xTo]() {
+        pData->loadHistory(xFrom, xTo);
+    }));
 }
 
 
 void
-Plot2D::ScatterPlot(QPainter* painter, DataStream2D* pData) {
-    int iMax = int(pData->m_pointArrayX.count());
-    if(iMax == 0) return;
+Plot2D::PointPlot(QPainter* painter, DataStream2D* pData, const DataSnapshot& window) {
+    int iFirst, iMax;
+    window.range(Ax.XMin, Ax.XMax, iFirst, iMax);
+    if(iFirst == iMax) return;
     QPen dataPen = QPen(pData->GetProperties().Color);
     dataPen.setWidth(pData->GetProperties().PenWidth);
     painter->setPen(dataPen);
-    int ix, iy;
+    const int n = TransformPoints(window, iFirst, iMax);
+    pointBuffer.clear();
+    for (int i=0; i < n; i++) {
+        if(pixelMask.at(i))
+            pointBuffer.append(QPoint(pixelX.at(i), pixelY.at(i)));
+    }//for (int i=0; i < n; i++)
+    painter->drawPoints(pointBuffer.constData(), pointBuffer.count());
+}
 
-    double xlmin, ylmin;
-    if(Ax.XMin > 0.0)
-        xlmin = log10(Ax.XMin);
-    else
-        xlmin = double(FLT_MIN);
-    if(Ax.YMin > 0.0)
-        ylmin = log10(Ax.YMin);
-    else ylmin = double(FLT_MIN);
 
-    int SYMBOLS_DIM = 8;
-    QSize Size(SYMBOLS_DIM, SYMBOLS_DIM);
+void
+Plot2D::ScatterPlot(QPainter* painter, DataStream2D* pData, const DataSnapshot& window) {
+    int iFirst, iMax;
+    window.range(Ax.XMin, Ax.XMax, iFirst, iMax);
+    if(iFirst == iMax) return;
+    // The sprite has the resolution of the device: its fragments are
+    // scaled back to the size of the symbol
+    const qreal dpr = painter->device()->devicePixelRatioF();
+    const QPixmap& sprite = SymbolPixmap(pData->GetId(), pData->GetProperties(), dpr);
+    const QRectF source(0.0, 0.0, sprite.width(), sprite.height());
+    const int n = TransformPoints(window, iFirst, iMax);
+    fragmentBuffer.clear();
+    for (int i=0; i < n; i++) {
+        if(pixelMask.at(i))
+            fragmentBuffer.append(QPainter::PixmapFragment::create(QPointF(pixelX.at(i), pixelY.at(i)), source, 1.0/dpr, 1.0/dpr));
+    }
+    painter->drawPixmapFragments(fragmentBuffer.constData(), fragmentBuffer.count(), sprite);
+}
 
-    for (int i=0; i < iMax; i++) {
-        if(pData->m_pointArrayX[i] >= Ax.XMin &&
-           pData->m_pointArrayX[i] <= Ax.XMax &&
-           pData->m_pointArrayY[i] >= Ax.YMin &&
-           pData->m_pointArrayY[i] <= Ax.YMax)
-        {
-            if(Ax.LogX)
-                if(pData->m_pointArrayX[i] > 0.0)
-                    ix = int(((log10(pData->m_pointArrayX[i]) - xlmin)*xfact) + Pf.left);
-                else
-                    ix = -INT_MAX;
-            else//Asse X Lineare
-                ix= int(((pData->m_pointArrayX[i] - Ax.XMin)*xfact) + Pf.left);
-            if(Ax.LogY) {
-                if(pData->m_pointArrayY[i] > 0.0)
-                    iy = int(((log10(pData->m_pointArrayY[i]) - ylmin)*yfact) + Pf.bottom);
-                else
-                    iy =-INT_MAX; // Solo per escludere il punto
-            } else
-                iy = int(((pData->m_pointArrayY[i] - Ax.YMin)*yfact) + Pf.bottom);
-
-            if(pData->GetProperties().Symbol == iplus) {
-                painter->drawLine(ix, iy-Size.height()/2, ix, iy+Size.height()/2+1);
-                painter->drawLine(ix-Size.width()/2, iy, ix+Size.width()/2+1, iy);
-            } else if(pData->GetProperties().Symbol == iper) {
-                painter->drawLine(ix-Size.width()/2+1, iy+Size.height()/2-1, ix+Size.width()/2-1, iy-Size.height()/2);
-                painter->drawLine(ix+Size.width()/2-1, iy+Size.height()/2-1, ix-Size.width()/2+1, iy-Size.height()/2);
-            } else if(pData->GetProperties().Symbol == istar) {
-                painter->drawLine(ix, iy-Size.height()/2, ix, iy+Size.height()/2+1);
-                painter->drawLine(ix-Size.width()/2, iy, ix+Size.width()/2+1, iy);
-                painter->drawLine(ix-Size.width()/2+1, iy+Size.height()/2-1, ix+Size.width()/2-1, iy-Size.height()/2);
-                painter->drawLine(ix+Size.width()/2-1, iy+Size.height()/2-1, ix-Size.width()/2+1, iy-Size.height()/2);
-            } else if(pData->GetProperties().Symbol == iuptriangle) {
-                painter->drawLine(ix, iy-Size.height()/2, ix+Size.width()/2, iy+Size.height()/2);
-                painter->drawLine(ix+Size.width()/2, iy+Size.height()/2, ix-Size.width()/2, iy+Size.height()/2);
-                painter->drawLine(ix-Size.width()/2, iy+Size.height()/2, ix, iy-Size.height()/2);
-            } else if(pData->GetProperties().Symbol == idntriangle) {
-                painter->drawLine(ix, iy+Size.height()/2, ix+Size.width()/2, iy-Size.height()/2);
-                painter->drawLine(ix+Size.width()/2, iy-Size.height()/2, ix-Size.width()/2, iy-Size.height()/2);
-                painter->drawLine(ix-Size.width()/2, iy-Size.height()/2, ix, iy+Size.height()/2);
-            } else if(pData->GetProperties().Symbol == icircle) {
-                painter->drawEllipse(QRect(ix-Size.width()/2, iy-Size.height()/2, Size.width(), Size.height()));
-            } else {
-                painter->drawLine(ix-Size.width()/2, iy, ix-Size.width()/2, iy-Size.height());
-                painter->drawLine(ix, iy-Size.height()/2, ix-Size.width(), iy-Size.height()/2);
-            }
-        }
+
+// The symbol of a data set is drawn only once, centered in a pixmap
+// of even side: each point then is a copy of the pixmap. The pixmap
+// has dpr device pixels per pixel, to stay sharp on high DPI screens,
+// and is drawn again when the plot moves to a screen of another ratio.
+const QPixmap&
+Plot2D::SymbolPixmap(int Id, const DataSetProperties& properties, qreal dpr) {
+    SymbolSprite& sprite = spriteCache[Id];
+    if(sprite.pixmap.isNull() ||
+       sprite.Symbol   != properties.Symbol ||
+       sprite.color    != properties.Color.rgba() ||
+       sprite.PenWidth != properties.PenWidth ||
+       sprite.dpr      != dpr)
+    {
+        const int side = 2*(SYMBOLS_DIM + properties.PenWidth + 2);
+        sprite.pixmap = QPixmap(qCeil(side*dpr), qCeil(side*dpr));
+        sprite.pixmap.setDevicePixelRatio(dpr);
+        sprite.pixmap.fill(Qt::transparent);
+        QPainter spritePainter(&sprite.pixmap);
+        QPen dataPen = QPen(properties.Color);
+        dataPen.setWidth(properties.PenWidth);
+        spritePainter.setPen(dataPen);
+        DrawSymbol(&spritePainter, properties.Symbol, side/2, side/2);
+        spritePainter.end();
+        sprite.Symbol   = properties.Symbol;
+        sprite.color    = properties.Color.rgba();
+        sprite.PenWidth = properties.PenWidth;
+        sprite.dpr      = dpr;
+    }
+    return sprite.pixmap;
+}
+
+
+void
+Plot2D::DrawSymbol(QPainter* painter, int Symbol, int ix, int iy) {
+    QSize Size(SYMBOLS_DIM, SYMBOLS_DIM);
+    if(Symbol == iplus) {
+        painter->drawLine(ix, iy-Size.height()/2, ix, iy+Size.height()/2+1);
+        painter->drawLine(ix-Size.width()/2, iy, ix+Size.width()/2+1, iy);
+    } else if(Symbol == iper) {
+        painter->drawLine(ix-Size.width()/2+1, iy+Size.height()/2-1, ix+Size.width()/2-1, iy-Size.height()/2);
+        painter->drawLine(ix+Size.width()/2-1, iy+Size.height()/2-1, ix-Size.width()/2+1, iy-Size.height()/2);
+    } else if(Symbol == istar) {
+        painter->drawLine(ix, iy-Size.height()/2, ix, iy+Size.height()/2+1);
+        painter->drawLine(ix-Size.width()/2, iy, ix+Size.width()/2+1, iy);
+        painter->drawLine(ix-Size.width()/2+1, iy+Size.height()/2-1, ix+Size.width()/2-1, iy-Size.height()/2);
+        painter->drawLine(ix+Size.width()/2-1, iy+Size.height()/2-1, ix-Size.width()/2+1, iy-Size.height()/2);
+    } else if(Symbol == iuptriangle) {
+        painter->drawLine(ix, iy-Size.height()/2, ix+Size.width()/2, iy+Size.height()/2);
+        painter->drawLine(ix+Size.width()/2, iy+Size.height()/2, ix-Size.width()/2, iy+Size.height()/2);
+        painter->drawLine(ix-Size.width()/2, iy+Size.height()/2, ix, iy-Size.height()/2);
+    } else if(Symbol == idntriangle) {
+        painter->drawLine(ix, iy+Size.height()/2, ix+Size.width()/2, iy-Size.height()/2);
+        painter->drawLine(ix+Size.width()/2, iy-Size.height()/2, ix-Size.width()/2, iy-Size.height()/2);
+        painter->drawLine(ix-Size.width()/2, iy-Size.height()/2, ix, iy+Size.height()/2);
+    } else if(Symbol == icircle) {
+        painter->drawEllipse(QRect(ix-Size.width()/2, iy-Size.height()/2, Size.width(), Size.height()));
+    } else {
+        painter->drawLine(ix-Size.width()/2, iy, ix-Size.width()/2, iy-Size.height());
+        painter->drawLine(ix, iy-Size.height()/2, ix-Size.width(), iy-Size.height()/2);
     }
 }
 
@@ -1021,9 +1197,12 @@ Plot2D::UpdatePlot() {
 
 void
 Plot2D::ClearPlot() {
+    historyLoader.waitForFinished();
+    pHistoryData = nullptr;
     while(!dataSetList.isEmpty()) {
         delete dataSetList.takeFirst();
     }
+    spriteCache.clear();
     update();
 }
 
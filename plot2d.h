@@ -22,9 +22,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "datastream2d.h"
 #include "AxisLimits.h"
 #include "AxisFrame.h"
+#include "pixeltransform.h"
 
 #include <QWidget>
 #include <QPen>
+#include <QPainter>
+#include <QPixmap>
+#include <QHash>
+#include <QFutureWatcher>
 
 
 class Plot2D : public QWidget
@@ -41,17 +46,20 @@ public:
     DataStream2D* NewDataSet(int Id, int PenWidth, QColor Color, int Symbol, QString Title);
     bool ClearDataSet(int Id);
     void NewPoint(int Id, double x, double y);
+    void NewPoints(int Id, const QVector<double>& x, const QVector<double>& y);
+    void PublishPoints();
     void SetShowDataSet(int Id, bool Show);
     void SetShowTitle(int Id, bool show);
     void ClearPlot();
-    void setMaxPoints(int nPoints);
-    int  getMaxPoints();
 
 signals:
 
 public slots:
     void UpdatePlot();
 
+protected slots:
+    void applyMemoryBudget();
+
 public:
     static const int iline       = 0;
     static const int ipoint      = 1;
@@ -62,6 +70,16 @@ public:
     static const int idntriangle = 6;
     static const int icircle     = 7;
 
+protected:
+    static const int SYMBOLS_DIM = 8;
+    struct SymbolSprite {
+        int     Symbol;
+        QRgb    color;
+        int     PenWidth;
+        qreal   dpr;     // Device pixels per pixel of the pixmap
+        QPixmap pixmap;
+    };
+
 protected:
     void closeEvent(QCloseEvent *event);
     void keyPressEvent(QKeyEvent *e);
@@ -73,10 +91,18 @@ protected:
     void YTicLin(QPainter* painter, QFontMetrics fontMetrics);
     void YTicLog(QPainter* painter, QFontMetrics fontMetrics);
     void DrawData(QPainter* painter, QFontMetrics fontMetrics);
-    void LinePlot(QPainter* painter, DataStream2D *pData);
-    void PointPlot(QPainter* painter, DataStream2D* pData);
-    void ScatterPlot(QPainter* painter, DataStream2D* pData);
-    void DrawLastPoint(QPainter* painter, DataStream2D* pData);
+    void LinePlot(QPainter* painter, DataStream2D* pData, const DataSnapshot& window);
+    void PointPlot(QPainter* painter, DataStream2D* pData, const DataSnapshot& window);
+    void ScatterPlot(QPainter* painter, DataStream2D* pData, const DataSnapshot& window);
+    void DrawLastPoint(QPainter* painter, DataStream2D* pData, const DataSnapshot& window);
+    void DrawSymbol(QPainter* painter, int Symbol, int ix, int iy);
+    const QPixmap& SymbolPixmap(int Id, const DataSetProperties& properties, qreal dpr);
+    void HistoryPlot(QPainter* painter, DataStream2D* pData, const DataSnapshot& window);
+    void LoadHistory(DataStream2D* pData, double xFrom, double xTo);
+    AxisTransform XTransform() const;
+    AxisTransform YTransform() const;
+    int  TransformPoints(const DataSnapshot& window, int first, int last);
+    void TransformHistory(const QVector<LodBucket>& buckets);
     void ShowTitle(QPainter* painter, QFontMetrics fontMetrics, DataStream2D* pData);
     void mousePressEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
@@ -98,6 +124,24 @@ protected:
     QString sTitle;
     QString sMouseCoord;
     double xfact, yfact;
+    // Pixel coordinates of the points being drawn (reused)
+    QVector<int> pixelX, pixelY;
+    QVector<quint8> pixelMask;
+    // Primitives sent to the painter in one call (reused)
+    QVector<QPoint> pointBuffer;
+    QVector<QLine>  lineBuffer;
+    QVector<LodBucket> historyBuckets;
+    QVector<double> historyX, historyY;
+    // Bucket columns and their pixels: x, yMin, yMax, yFirst, yLast (reused)
+    QVector<double> historyValues, historyLogValues;
+    QVector<int> historyPixels;
+    QVector<quint8> historyMask;
+    // Reads back the history samples in a worker thread
+    QFutureWatcher<void> historyLoader;
+    DataStream2D* pHistoryData;
+    double historyFrom, historyTo;
+    QVector<QPainter::PixmapFragment> fragmentBuffer;
+    QHash<int, SymbolSprite> spriteCache; // By data set Id
     QPoint lastPos, zoomStart, zoomEnd;
     plotPropertiesDlg* pPropertiesDlg;
 };
@@ -43,8 +43,8 @@ plotPropertiesDlg::plotPropertiesDlg(QString sTitle, QWidget *parent)
 
     pLayout->addWidget(new QLabel("Grid Lines Width"), 3, 0, 1, 1);
     pLayout->addWidget(&gridPenWidthEdit,              3, 1, 1, 1);
-    pLayout->addWidget(new QLabel("Max Data Points"),  4, 0, 1, 1);
-    pLayout->addWidget(&maxDataPointsEdit,             4, 1, 1, 1);
+    pLayout->addWidget(new QLabel("Memory Budget [MB]"), 4, 0, 1, 1);
+    pLayout->addWidget(&memoryBudgetEdit,                4, 1, 1, 1);
 
     pLayout->addWidget(pButtonBox, 5, 0, 1, 2);
 
@@ -71,7 +71,8 @@ plotPropertiesDlg::restoreSettings() {
     gridColor.setRgba(settings.value("GridColor",           QColor(Qt::blue).rgba()).toUInt());
     labelColor.setRgba(settings.value("LabelColor",         QColor(Qt::white).rgba()).toUInt());
     gridPenWidth      = settings.value("GridPenWidth",      1).toInt();
-    maxDataPoints     = settings.value("MaxDataPoints",     4000).toInt();
+    memoryBudgetMB    = settings.value("MemoryBudgetMB",    16).toInt();
+    appliedBudgetMB   = memoryBudgetMB;
     painterFontName   = settings.value("PainterFontName",   QString("Ubuntu")).toString();
     painterFontSize   = settings.value("PainterFontSize",   16).toInt();
     painterFontWeight = QFont::Weight(settings.value("PainterFontWeight", QFont::Bold).toInt());
@@ -93,7 +94,7 @@ plotPropertiesDlg::saveSettings() {
     settings.setValue("FrameColor", frameColor.rgba());
     settings.setValue("PainterBKColor", painterBkColor.rgba());
     settings.setValue("GridPenWidth", gridPenWidth);
-    settings.setValue("MaxDataPoints", maxDataPoints);
+    settings.setValue("MemoryBudgetMB", memoryBudgetMB);
     settings.setValue("PainterFontName", painterFontName);
     settings.setValue("PainterFontSize", painterFontSize);
     settings.setValue("PainterFontWeight", painterFontWeight);
@@ -105,7 +106,7 @@ void
 plotPropertiesDlg::setToolTips() {
     QString sHeader = QString("Enter values in range [%1 : %2]");
     gridPenWidthEdit.setToolTip(sHeader.arg(1).arg(10));
-    maxDataPointsEdit.setToolTip(sHeader.arg(1).arg(10000));
+    memoryBudgetEdit.setToolTip(sHeader.arg(1).arg(4096));
 }
 
 
@@ -118,7 +119,7 @@ plotPropertiesDlg::initUI() {
     labelFontButton.setText("Label Font");
 
     gridPenWidthEdit.setText(QString("%1").arg(gridPenWidth));
-    maxDataPointsEdit.setText(QString("%1").arg(maxDataPoints));
+    memoryBudgetEdit.setText(QString("%1").arg(memoryBudgetMB));
 
     pButtonBox = new QDialogButtonBox(QDialogButtonBox::Ok |
                                       QDialogButtonBox::Cancel);
@@ -141,8 +142,8 @@ plotPropertiesDlg::connectSignals() {
     // Line Edit
     connect(&gridPenWidthEdit, SIGNAL(textChanged(QString)),
             this, SLOT(onChangeGridPenWidth(QString)));
-    connect(&maxDataPointsEdit, SIGNAL(textChanged(QString)),
-            this, SLOT(onChangeMaxDataPoints(QString)));
+    connect(&memoryBudgetEdit, SIGNAL(textChanged(QString)),
+            this, SLOT(onChangeMemoryBudget(QString)));
     // Button Box
     connect(pButtonBox, SIGNAL(accepted()),
             this, SLOT(onOk()));
@@ -159,9 +160,15 @@ plotPropertiesDlg::onCancel() {
 }
 
 
+// The memory budget is applied only here: resizing the stores
+// at every keystroke would evict the points for nothing
 void
 plotPropertiesDlg::onOk() {
     saveSettings();
+    if(memoryBudgetMB != appliedBudgetMB) {
+        appliedBudgetMB = memoryBudgetMB;
+        emit memoryBudgetChanged();
+    }
     accept();
 }
 
@@ -243,16 +250,15 @@ plotPropertiesDlg::onChangeGridPenWidth(const QString sNewVal) {
 
 
 void
-plotPropertiesDlg::onChangeMaxDataPoints(const QString sNewVal) {
+plotPropertiesDlg::onChangeMemoryBudget(const QString sNewVal) {
     if((sNewVal.toInt() > 0) &&
-       (sNewVal.toInt() < 10001))
+       (sNewVal.toInt() < 4097))
     {
-        maxDataPoints = sNewVal.toInt();
-        maxDataPointsEdit.setStyleSheet(sNormalStyle);
-        emit configChanged();
+        memoryBudgetMB = sNewVal.toInt();
+        memoryBudgetEdit.setStyleSheet(sNormalStyle);
     }
     else {
-        maxDataPointsEdit.setStyleSheet(sErrorStyle);
+        memoryBudgetEdit.setStyleSheet(sErrorStyle);
     }
 }
 
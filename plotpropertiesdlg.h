@@ -40,11 +40,12 @@ public:
     QColor painterBkColor;
 
     int gridPenWidth;
-    int maxDataPoints;
+    int memoryBudgetMB;
     QFont painterFont;
 
 signals:
     void configChanged();
+    void memoryBudgetChanged();
 
 public slots:
     void onChangeBkColor();
@@ -53,7 +54,7 @@ public slots:
     void onChangeLabelsColor();
     void onChangeLabelsFont();
     void onChangeGridPenWidth(const QString sNewVal);
-    void onChangeMaxDataPoints(const QString sNewVal);
+    void onChangeMemoryBudget(const QString sNewVal);
     void onCancel();
     void onOk();
 
@@ -69,6 +70,7 @@ private:
     int painterFontSize;
     QFont::Weight painterFontWeight;
     bool painterFontItalic;
+    int appliedBudgetMB; // The memoryBudgetMB the plot is using
     // Buttons
     QPushButton BkColorButton;
     QPushButton frameColorButton;
@@ -77,7 +79,7 @@ private:
     QPushButton labelFontButton;
     // Line Edit
     QLineEdit   gridPenWidthEdit;
-    QLineEdit   maxDataPointsEdit;
+    QLineEdit   memoryBudgetEdit;
     // QLineEdit styles
     QString sNormalStyle;
     QString sErrorStyle;
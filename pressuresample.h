@@ -0,0 +1,60 @@
+// MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QtGlobal>
+#include <chrono>
+
+
+// Nanoseconds of the monotonic clock (CLOCK_MONOTONIC on Linux).
+// Unaffected by wall clock adjustments: only differences make sense.
+inline qint64
+monotonicNSecs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// A single gauge reading, as handed from the acquisition
+// thread to the GUI.
+struct PressureSample
+{
+    // Gauge status codes as transmitted by the TPG 261
+    enum Status {
+        MeasurementOk       = 0,
+        Underrange          = 1,
+        Overrange           = 2,
+        SensorError         = 3,
+        SensorOff           = 4,
+        NoSensor            = 5,
+        IdentificationError = 6
+    };
+
+    bool hasPressure() const {
+        return status <= Overrange;
+    }
+
+    qint64 monotonicNs;     // When its terminating LF was received
+    double pressure;        // [mbar]
+    int    status;
+};
@@ -0,0 +1,264 @@
+/*
+ *
+Copyright (C) 2021  Gabriele Salvato
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+#include "samplestore.h"
+
+#include <QDir>
+#include <algorithm>
+
+
+SampleStore::SampleStore()
+    : budget(8*1024*1024)
+    , generation(0)
+{
+    file.setFileTemplate(QDir::tempPath() + "/tgp261-XXXXXX.samples");
+    nSamples = 0;
+}
+
+
+qint64
+SampleStore::pageBytes() {
+    return 2*pageSamples*qint64(sizeof(double));
+}
+
+
+// The spill file is kept open and reused
+void
+SampleStore::clear() {
+    pages.clear();
+    lru.clear();
+    nSamples = 0;
+    generation++;
+    if(file.isOpen())
+        file.resize(0);
+}
+
+
+void
+SampleStore::setMemoryBudget(qint64 nBytes) {
+    budget = qMax(qint64(0), nBytes);
+    trim();
+}
+
+
+qint64
+SampleStore::count() const {
+    return nSamples;
+}
+
+
+// Samples in the pages overlapping [xFrom, xTo]: no disk access
+qint64
+SampleStore::count(double xFrom, double xTo) const {
+    qint64 n = 0;
+    for(int i=firstPage(xFrom); i<pages.count() && pages.at(i).xFirst<=xTo; i++)
+        n += pages.at(i).nSamples;
+    return n;
+}
+
+
+// The page being filled is always in memory
+qint64
+SampleStore::residentBytes() const {
+    qint64 nBytes = qint64(lru.size())*pageBytes();
+    if(!pages.isEmpty() && pages.last().nSamples < pageSamples)
+        nBytes += pageBytes();
+    return nBytes;
+}
+
+
+QString
+SampleStore::errorString() const {
+    return sError;
+}
+
+
+void
+SampleStore::append(double x, double y) {
+    if(pages.isEmpty() || pages.last().nSamples == pageSamples) {
+        Page page;
+        page.xFirst   = x;
+        page.nSamples = 0;
+        page.offset   = -1;
+        page.x.reserve(pageSamples);
+        page.y.reserve(pageSamples);
+        pages.append(page);
+    }
+    Page& page = pages.last();
+    page.x.append(x);
+    page.y.append(y);
+    page.xLast = x;
+    page.nSamples++;
+    nSamples++;
+    if(page.nSamples == pageSamples) {
+        page.lruPosition = lru.insert(lru.end(), pages.count()-1);
+        trim();
+    }
+}
+
+
+int
+SampleStore::firstPage(double xFrom) const {
+    return int(std::lower_bound(pages.begin(), pages.end(), xFrom,
+                                [](const Page& page, double x) { return page.xLast < x; })
+               - pages.begin());
+}
+
+
+bool
+SampleStore::isResident(const Page& page) const {
+    return page.x.count() == page.nSamples;
+}
+
+
+// Copies the samples with x in [xFrom, xTo] if all their pages
+// are in memory: false if any of them has to be read back.
+bool
+SampleStore::read(double xFrom, double xTo, QVector<double>& x, QVector<double>& y) {
+    x.clear();
+    y.clear();
+    const int first = firstPage(xFrom);
+    int last = first;
+    for(; last<pages.count() && pages.at(last).xFirst<=xTo; last++) {
+        if(!isResident(pages.at(last)))
+            return false;
+    }
+    for(int i=first; i<last; i++) {
+        Page& page = pages[i];
+        if(page.nSamples == pageSamples) // Most recently used
+            lru.splice(lru.end(), lru, page.lruPosition);
+        for(int j=0; j<page.nSamples; j++) {
+            if(page.x.at(j) >= xFrom && page.x.at(j) <= xTo) {
+                x.append(page.x.at(j));
+                y.append(page.y.at(j));
+            }
+        }
+    }
+    return true;
+}
+
+
+// The pages of [xFrom, xTo] not in memory
+QVector<SampleStore::PageLoad>
+SampleStore::pagesToLoad(double xFrom, double xTo) const {
+    QVector<PageLoad> loads;
+    for(int i=firstPage(xFrom); i<pages.count() && pages.at(i).xFirst<=xTo; i++) {
+        const Page& page = pages.at(i);
+        if(isResident(page))
+            continue;
+        PageLoad load;
+        load.page       = i;
+        load.generation = generation;
+        load.offset     = page.offset;
+        load.nSamples   = page.nSamples;
+        loads.append(load);
+    }
+    return loads;
+}
+
+
+QString
+SampleStore::fileName() const {
+    return file.fileName();
+}
+
+
+// Reads the pages from their own handle of the spill file:
+// the store is not touched, so its lock need not be held.
+bool
+SampleStore::loadPages(QString sFileName, QVector<PageLoad>& loads, QString& sError) {
+    QFile spillFile(sFileName);
+    if(!spillFile.open(QIODevice::ReadOnly)) {
+        sError = QString("Unable to open %1: %2").arg(sFileName, spillFile.errorString());
+        return false;
+    }
+    for(int i=0; i<loads.count(); i++) {
+        PageLoad& load = loads[i];
+        const qint64 nBytes = load.nSamples*qint64(sizeof(double));
+        load.x.resize(load.nSamples);
+        load.y.resize(load.nSamples);
+        if(!spillFile.seek(load.offset) ||
+           spillFile.read(reinterpret_cast<char*>(load.x.data()), nBytes) != nBytes ||
+           spillFile.read(reinterpret_cast<char*>(load.y.data()), nBytes) != nBytes)
+        {
+            sError = QString("Unable to read %1: %2").arg(sFileName, spillFile.errorString());
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// The pages read back become the most recently used ones.
+// Those of a store cleared meanwhile are ignored.
+void
+SampleStore::install(QVector<PageLoad>& loads) {
+    for(int i=0; i<loads.count(); i++) {
+        PageLoad& load = loads[i];
+        if(load.generation != generation || load.page >= pages.count())
+            continue;
+        Page& page = pages[load.page];
+        if(isResident(page) || page.offset != load.offset)
+            continue;
+        page.x.swap(load.x);
+        page.y.swap(load.y);
+        page.lruPosition = lru.insert(lru.end(), load.page);
+    }
+    trim();
+}
+
+
+// Pages never change once complete, so they are written only once.
+// The file is flushed for the handles of loadPages().
+bool
+SampleStore::spill(Page& page) {
+    if(page.offset >= 0)
+        return true;
+    if(!file.isOpen() && !file.open()) {
+        sError = QString("Unable to create %1: %2").arg(file.fileTemplate(), file.errorString());
+        return false;
+    }
+    const qint64 offset = file.size();
+    const qint64 nBytes = page.nSamples*qint64(sizeof(double));
+    if(!file.seek(offset) ||
+       file.write(reinterpret_cast<const char*>(page.x.constData()), nBytes) != nBytes ||
+       file.write(reinterpret_cast<const char*>(page.y.constData()), nBytes) != nBytes ||
+       !file.flush())
+    {
+        sError = QString("Unable to write %1: %2").arg(file.fileName(), file.errorString());
+        file.resize(offset);
+        return false;
+    }
+    page.offset = offset;
+    return true;
+}
+
+
+// Drops the least recently used complete pages until the budget is met.
+// A page that cannot be written stays in memory: no sample is lost.
+void
+SampleStore::trim() {
+    while(!lru.empty() && qint64(lru.size())*pageBytes() > budget) {
+        Page& page = pages[lru.front()];
+        if(!spill(page))
+            return;
+        page.x = QVector<double>();
+        page.y = QVector<double>();
+        lru.pop_front();
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ *
+Copyright (C) 2021  Gabriele Salvato
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+#pragma once
+
+#include <QVector>
+#include <QString>
+#include <QTemporaryFile>
+#include <list>
+
+
+// Append-only store of (x, y) samples in pages of pageSamples samples.
+// The complete pages beyond the memory budget are written once to a
+// temporary file and dropped from memory, the least recently used
+// first. read() never touches the disk: the pages it misses are read
+// back with pagesToLoad(), loadPages() and install(), so that the
+// file can be read without holding the lock of the store.
+// The x values are assumed to be non decreasing (time series).
+class SampleStore
+{
+public:
+    // A page to be read back from the file
+    struct PageLoad {
+        int    page;
+        qint64 generation; // Of the store when asked
+        qint64 offset;
+        int    nSamples;
+        QVector<double> x;
+        QVector<double> y;
+    };
+
+    SampleStore();
+    void clear();
+    void append(double x, double y);
+    void setMemoryBudget(qint64 nBytes);
+    qint64 count() const;
+    qint64 count(double xFrom, double xTo) const;
+    qint64 residentBytes() const;
+    bool read(double xFrom, double xTo, QVector<double>& x, QVector<double>& y);
+    QVector<PageLoad> pagesToLoad(double xFrom, double xTo) const;
+    QString fileName() const;
+    static bool loadPages(QString sFileName, QVector<PageLoad>& loads, QString& sError);
+    void install(QVector<PageLoad>& loads);
+    QString errorString() const;
+
+public:
+    static const int pageSamples = 4096;
+
+protected:
+    struct Page {
+        double xFirst;
+        double xLast;
+        int    nSamples;
+        qint64 offset;    // In the spill file, -1 if never written
+        std::list<int>::iterator lruPosition; // If complete and in memory
+        QVector<double> x;
+        QVector<double> y;
+    };
+    int  firstPage(double xFrom) const;
+    bool isResident(const Page& page) const;
+    bool spill(Page& page);
+    void trim();
+    static qint64 pageBytes();
+
+protected:
+    QVector<Page> pages;
+    std::list<int> lru;   // The complete pages in memory, oldest use first
+    QTemporaryFile file;
+    qint64 nSamples;
+    qint64 budget;
+    qint64 generation;    // Incremented by clear()
+    QString sError;
+};
@@ -0,0 +1,203 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include "segmentindex.h"
+
+#include <QFileInfo>
+#include <QDir>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+
+static const char indexMagic[8] = {'T','P','G','2','6','1','I','\n'};
+static const quint32 indexVersion = 1;
+
+
+SegmentIndex::SegmentIndex()
+    : pMap(nullptr)
+    , pHeader(nullptr)
+    , pEntries(nullptr)
+    , nEntries(0)
+{
+}
+
+
+SegmentIndex::~SegmentIndex() {
+    close();
+}
+
+
+// "dir/data.dat" -> "dir/data.0003.dat"
+QString
+SegmentIndex::segmentFileName(QString sFileName, int segment) {
+    QFileInfo info(sFileName);
+    QString sSuffix = info.suffix().isEmpty() ? QString() : "." + info.suffix();
+    return QString("%1/%2.%3%4")
+           .arg(info.path(), info.completeBaseName())
+           .arg(segment, 4, 10, QChar('0'))
+           .arg(sSuffix);
+}
+
+
+// "dir/data.dat" -> "dir/data.idx"
+QString
+SegmentIndex::indexFileName(QString sFileName) {
+    QFileInfo info(sFileName);
+    return QString("%1/%2.idx").arg(info.path(), info.completeBaseName());
+}
+
+
+// "dir/data.idx" -> "dir/data.dat": the suffix is the one of
+// the first segment (empty if there is none)
+QString
+SegmentIndex::dataFileName(QString sIndexFileName) {
+    QFileInfo info(sIndexFileName);
+    QString sBaseName = info.completeBaseName();
+    QStringList firstSegments = QDir(info.path()).entryList(QStringList(sBaseName + ".0000*"),
+                                                            QDir::Files, QDir::Name);
+    QString sSuffix;
+    if(!firstSegments.isEmpty())
+        sSuffix = QFileInfo(firstSegments.first()).suffix();
+    if(sSuffix == "0000")
+        sSuffix.clear();
+    return QString("%1/%2%3").arg(info.path(), sBaseName,
+                                  sSuffix.isEmpty() ? QString() : "." + sSuffix);
+}
+
+
+QByteArray
+SegmentIndex::header(qint64 startMsecsSinceEpoch) {
+    SegmentIndexHeader indexHeader;
+    std::memcpy(indexHeader.magic, indexMagic, sizeof(indexMagic));
+    indexHeader.version              = indexVersion;
+    indexHeader.entrySize            = sizeof(SegmentIndexEntry);
+    indexHeader.startMsecsSinceEpoch = startMsecsSinceEpoch;
+    return QByteArray(reinterpret_cast<const char*>(&indexHeader), sizeof(indexHeader));
+}
+
+
+QByteArray
+SegmentIndex::entry(double time, int segment, qint64 offset) {
+    SegmentIndexEntry indexEntry;
+    indexEntry.time     = time;
+    indexEntry.segment  = quint32(segment);
+    indexEntry.reserved = 0;
+    indexEntry.offset   = offset;
+    return QByteArray(reinterpret_cast<const char*>(&indexEntry), sizeof(indexEntry));
+}
+
+
+bool
+SegmentIndex::open(QString sIndexFileName) {
+    close();
+    file.setFileName(sIndexFileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        sError = file.errorString();
+        return false;
+    }
+    const qint64 fileSize = file.size();
+    pMap = fileSize >= qint64(sizeof(SegmentIndexHeader)) ? file.map(0, fileSize) : nullptr;
+    pHeader = reinterpret_cast<const SegmentIndexHeader*>(pMap);
+    if(!pMap ||
+       std::memcmp(pHeader->magic, indexMagic, sizeof(indexMagic)) ||
+       pHeader->entrySize != sizeof(SegmentIndexEntry))
+    {
+        sError = QString("Not a TPG261I file");
+        close();
+        return false;
+    }
+    if(pHeader->version != indexVersion) {
+        sError = QString("Unsupported file version %1").arg(pHeader->version);
+        close();
+        return false;
+    }
+    // A partially written last entry is ignored
+    pEntries = reinterpret_cast<const SegmentIndexEntry*>(pMap + sizeof(SegmentIndexHeader));
+    nEntries = int((fileSize-qint64(sizeof(SegmentIndexHeader))) / qint64(sizeof(SegmentIndexEntry)));
+    return true;
+}
+
+
+void
+SegmentIndex::close() {
+    pHeader  = nullptr;
+    pEntries = nullptr;
+    nEntries = 0;
+    if(pMap)
+        file.unmap(pMap);
+    pMap = nullptr;
+    if(file.isOpen())
+        file.close();
+}
+
+
+QString
+SegmentIndex::errorString() const {
+    return sError;
+}
+
+
+qint64
+SegmentIndex::startMsecsSinceEpoch() const {
+    return pHeader ? pHeader->startMsecsSinceEpoch : 0;
+}
+
+
+int
+SegmentIndex::entryCount() const {
+    return nEntries;
+}
+
+
+const SegmentIndexEntry&
+SegmentIndex::entry(int i) const {
+    return pEntries[i];
+}
+
+
+// The time of the last entry (-inf if there is none)
+double
+SegmentIndex::lastTime() const {
+    if(nEntries == 0)
+        return -std::numeric_limits<double>::infinity();
+    return pEntries[nEntries-1].time;
+}
+
+
+// Where to start reading to find the samples at (or after) time:
+// the last entry not later than time. Returns false if time
+// precedes the whole acquisition.
+bool
+SegmentIndex::locate(double time, int& segment, qint64& offset) const {
+    const SegmentIndexEntry* pEnd = pEntries + nEntries;
+    const SegmentIndexEntry* pNext = std::upper_bound(pEntries, pEnd, time,
+                                                      [](double t, const SegmentIndexEntry& indexEntry) {
+                                                          return t < indexEntry.time;
+                                                      });
+    if(pNext == pEntries)
+        return false;
+    segment = int(pNext[-1].segment);
+    offset  = pNext[-1].offset;
+    return true;
+}
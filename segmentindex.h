@@ -0,0 +1,81 @@
+// MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+
+// Sidecar index of a segmented acquisition:
+//    a SegmentIndexHeader followed by SegmentIndexEntry records in
+//    increasing time order. Each entry gives the segment and the byte
+//    offset where the record (or block) starting at that time is.
+// The segments of "data.dat" are "data.0000.dat", "data.0001.dat", ...
+// and the index is "data.idx".
+struct SegmentIndexHeader
+{
+    char    magic[8];             // "TPG261I\n"
+    quint32 version;
+    quint32 entrySize;            // == sizeof(SegmentIndexEntry)
+    qint64  startMsecsSinceEpoch; // Wall clock at Time = 0 s
+};
+
+
+struct SegmentIndexEntry
+{
+    double  time;                 // [s]
+    quint32 segment;
+    quint32 reserved;
+    qint64  offset;               // In the segment file
+};
+
+
+class SegmentIndex
+{
+public:
+    SegmentIndex();
+    ~SegmentIndex();
+    static QString segmentFileName(QString sFileName, int segment);
+    static QString indexFileName(QString sFileName);
+    static QString dataFileName(QString sIndexFileName);
+    static QByteArray header(qint64 startMsecsSinceEpoch);
+    static QByteArray entry(double time, int segment, qint64 offset);
+
+    bool open(QString sIndexFileName);
+    void close();
+    QString errorString() const;
+    qint64 startMsecsSinceEpoch() const;
+    int entryCount() const;
+    const SegmentIndexEntry& entry(int i) const;
+    double lastTime() const;
+    bool locate(double time, int& segment, qint64& offset) const;
+
+protected:
+    QFile   file;
+    uchar*  pMap;
+    const SegmentIndexHeader* pHeader;
+    const SegmentIndexEntry*  pEntries;
+    int     nEntries;
+    QString sError;
+};
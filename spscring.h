@@ -0,0 +1,78 @@
+// MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+
+// Bounded Single-Producer/Single-Consumer ring.
+// push() must be called from one thread only and pop() from one
+// (possibly different) thread only. Neither call ever blocks:
+// when the ring is full push() fails, so a stalled consumer can
+// never back-pressure the producer.
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert((Capacity & (Capacity-1)) == 0,
+                  "SpscRing Capacity must be a power of two");
+
+public:
+    SpscRing()
+        : head(0)
+        , tail(0)
+    {
+    }
+
+    bool push(const T& item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if(t - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        buffer[t & (Capacity-1)] = item;
+        tail.store(t+1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if(h == tail.load(std::memory_order_acquire))
+            return false;
+        item = buffer[h & (Capacity-1)];
+        head.store(h+1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) -
+               head.load(std::memory_order_acquire);
+    }
+
+    static size_t capacity() {
+        return Capacity;
+    }
+
+private:
+    T buffer[Capacity];
+    std::atomic<size_t> head; // Written by the consumer only
+    std::atomic<size_t> tail; // Written by the producer only
+};
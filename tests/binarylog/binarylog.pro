@@ -0,0 +1,13 @@
+QT += testlib
+QT -= gui
+
+CONFIG += testcase console c++17
+CONFIG -= app_bundle
+
+TARGET = tst_binarylog
+INCLUDEPATH += ../..
+
+SOURCES += \
+    tst_binarylog.cpp \
+    ../../binarylog.cpp \
+    ../../textrecord.cpp
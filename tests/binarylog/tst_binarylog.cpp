@@ -0,0 +1,137 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include <QtTest>
+#include <QTemporaryFile>
+
+#include "binarylog.h"
+
+#include <cstring>
+
+
+class TestBinaryLog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip();
+    void truncatedBlock();
+    void corruptedCount_data();
+    void corruptedCount();
+};
+
+
+static const int blockSamples = 16;
+
+
+// Two full blocks and a short one
+static QByteArray
+encodedLog() {
+    BinaryLogEncoder encoder(blockSamples);
+    QByteArray log = BinaryLogEncoder::header("Sample A", 1234567890123, blockSamples);
+    for(int i=0; i<2*blockSamples+5; i++) {
+        encoder.append(i*0.1, 1.0e-3*(i+1), i%3);
+        if(encoder.isBlockFull())
+            log += encoder.finishBlock();
+    }
+    log += encoder.finishBlock();
+    return log;
+}
+
+
+static bool
+writeFile(QTemporaryFile& file, const QByteArray& contents) {
+    if(!file.open())
+        return false;
+    file.write(contents);
+    file.close();
+    return true;
+}
+
+
+void
+TestBinaryLog::roundTrip() {
+    QTemporaryFile file;
+    QVERIFY(writeFile(file, encodedLog()));
+    BinaryLogReader reader;
+    QVERIFY(reader.open(file.fileName()));
+    QCOMPARE(reader.info(), QString("Sample A"));
+    QCOMPARE(reader.startMsecsSinceEpoch(), qint64(1234567890123));
+    QCOMPARE(reader.blockCount(), 3);
+    QCOMPARE(reader.sampleCount(), qint64(2*blockSamples+5));
+    int i = 0;
+    for(int iBlock=0; iBlock<reader.blockCount(); iBlock++) {
+        const BinaryLogReader::Block& block = reader.block(iBlock);
+        for(int j=0; j<block.count; j++, i++) {
+            QCOMPARE(block.pTime[j], i*0.1);
+            QCOMPARE(block.pPressure[j], 1.0e-3*(i+1));
+            QCOMPARE(int(block.pStatus[j]), i%3);
+        }
+    }
+}
+
+
+// A crash in the middle of the last block loses only that block
+void
+TestBinaryLog::truncatedBlock() {
+    QByteArray log = encodedLog();
+    log.resize(log.size()-8);
+    QTemporaryFile file;
+    QVERIFY(writeFile(file, log));
+    BinaryLogReader reader;
+    QVERIFY(reader.open(file.fileName()));
+    QCOMPARE(reader.blockCount(), 2);
+    QCOMPARE(reader.sampleCount(), qint64(2*blockSamples));
+}
+
+
+void
+TestBinaryLog::corruptedCount_data() {
+    QTest::addColumn<quint32>("count");
+    QTest::newRow("longer than the block")  << quint32(blockSamples+1);
+    QTest::newRow("longer than the file")   << quint32(1000000);
+    QTest::newRow("overflows 32 bits")      << quint32(0x7fffffff);
+    QTest::newRow("negative as an int")     << quint32(0xffffffff);
+}
+
+
+// The block with a corrupted count and the following ones
+// are ignored, whatever the count
+void
+TestBinaryLog::corruptedCount() {
+    QFETCH(quint32, count);
+    QByteArray log = encodedLog();
+    const int secondBlock = BinaryLogHeader::headerSize + BinaryLogEncoder::blockBytes(blockSamples);
+    std::memcpy(log.data()+secondBlock+offsetof(BinaryLogBlockHeader, count), &count, sizeof(count));
+    QTemporaryFile file;
+    QVERIFY(writeFile(file, log));
+    BinaryLogReader reader;
+    QVERIFY(reader.open(file.fileName()));
+    QCOMPARE(reader.blockCount(), 1);
+    QCOMPARE(reader.sampleCount(), qint64(blockSamples));
+}
+
+
+QTEST_APPLESS_MAIN(TestBinaryLog)
+
+#include "tst_binarylog.moc"
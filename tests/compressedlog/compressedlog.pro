@@ -0,0 +1,14 @@
+QT += testlib
+QT -= gui
+
+CONFIG += testcase console c++17
+CONFIG -= app_bundle
+
+TARGET = tst_compressedlog
+INCLUDEPATH += ../..
+
+SOURCES += \
+    tst_compressedlog.cpp \
+    ../../compressedlog.cpp \
+    ../../binarylog.cpp \
+    ../../textrecord.cpp
@@ -0,0 +1,171 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include <QtTest>
+#include <QTemporaryFile>
+
+#include "compressedlog.h"
+
+#include <cmath>
+
+
+class TestCompressedLog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip();
+    void decodeRange();
+    void openChunk();
+};
+
+
+struct Samples {
+    QVector<double> times;
+    QVector<double> pressures;
+    QVector<quint8> statuses;
+};
+
+
+// 1 s samples timed at the arrival of their LF: jitter from a few
+// nanoseconds to seconds, to use every delta-of-delta bucket
+static Samples
+acquisition(int count) {
+    Samples samples;
+    qint64 ns = 0;
+    for(int i=0; i<count; i++) {
+        static const qint64 jitters[] = {0, 7, 300000, 4000000, 150000000, 3000000000};
+        ns += 1000000000 + jitters[i%6]*((i & 1) ? 1 : -1)/2;
+        samples.times.append(double(ns)*1.0e-9);
+        samples.pressures.append(1013.25*std::exp(-i/500.0));
+        samples.statuses.append(quint8((i/100)%3 == 2 ? 1 : 0));
+    }
+    return samples;
+}
+
+
+static QByteArray
+encode(const Samples& samples, int chunkSamples) {
+    CompressedLogEncoder encoder(chunkSamples);
+    QByteArray log = CompressedLogEncoder::header("Sample A", 1234567890123, chunkSamples);
+    for(int i=0; i<samples.times.count(); i++) {
+        encoder.append(samples.times.at(i), samples.pressures.at(i), samples.statuses.at(i));
+        if(encoder.isChunkFull())
+            log += encoder.finishChunk();
+    }
+    if(encoder.pendingSamples() > 0)
+        log += encoder.finishChunk();
+    return log;
+}
+
+
+static bool
+writeFile(QTemporaryFile& file, const QByteArray& contents) {
+    if(!file.open())
+        return false;
+    file.write(contents);
+    file.close();
+    return true;
+}
+
+
+// Pressures and status codes are exact, times within half a microsecond
+void
+TestCompressedLog::roundTrip() {
+    const Samples samples = acquisition(2000);
+    QTemporaryFile file;
+    QVERIFY(writeFile(file, encode(samples, 512)));
+    CompressedLogReader reader;
+    QVERIFY(reader.open(file.fileName()));
+    QCOMPARE(reader.info(), QString("Sample A"));
+    QCOMPARE(reader.startMsecsSinceEpoch(), qint64(1234567890123));
+    QCOMPARE(reader.chunkCount(), 4);
+    QCOMPARE(reader.sampleCount(), qint64(2000));
+    Samples decoded;
+    for(int iChunk=0; iChunk<reader.chunkCount(); iChunk++)
+        QVERIFY(reader.decodeChunk(iChunk, decoded.times, decoded.pressures, decoded.statuses));
+    QCOMPARE(decoded.times.count(), 2000);
+    for(int i=0; i<2000; i++) {
+        QVERIFY2(std::fabs(decoded.times.at(i)-samples.times.at(i)) <= 0.5e-6,
+                 qPrintable(QString("sample %1").arg(i)));
+        QVERIFY(decoded.pressures.at(i) == samples.pressures.at(i));
+        QCOMPARE(decoded.statuses.at(i), samples.statuses.at(i));
+    }
+}
+
+
+void
+TestCompressedLog::decodeRange() {
+    const Samples samples = acquisition(2000);
+    QTemporaryFile file;
+    QVERIFY(writeFile(file, encode(samples, 256)));
+    CompressedLogReader reader;
+    QVERIFY(reader.open(file.fileName()));
+    const double fromTime = samples.times.at(700) - 0.1;
+    const double toTime   = samples.times.at(1300) + 0.1;
+    Samples decoded;
+    QVERIFY(reader.decodeRange(fromTime, toTime, decoded.times, decoded.pressures, decoded.statuses));
+    QCOMPARE(decoded.times.count(), 601);
+    QVERIFY(decoded.pressures.first() == samples.pressures.at(700));
+    QVERIFY(decoded.pressures.last() == samples.pressures.at(1300));
+}
+
+
+// The open chunk, written as the tail of the file, is a complete one
+void
+TestCompressedLog::openChunk() {
+    const Samples samples = acquisition(300);
+    CompressedLogEncoder encoder(512);
+    for(int i=0; i<200; i++)
+        encoder.append(samples.times.at(i), samples.pressures.at(i), samples.statuses.at(i));
+    const QByteArray tail = encoder.peekChunk();
+    QCOMPARE(encoder.pendingSamples(), 200);
+    for(int i=200; i<300; i++)
+        encoder.append(samples.times.at(i), samples.pressures.at(i), samples.statuses.at(i));
+    const QByteArray chunk = encoder.finishChunk();
+
+    QTemporaryFile tailFile;
+    QVERIFY(writeFile(tailFile, CompressedLogEncoder::header(QString(), 0, 512) + tail));
+    CompressedLogReader reader;
+    QVERIFY(reader.open(tailFile.fileName()));
+    QCOMPARE(reader.sampleCount(), qint64(200));
+    Samples decoded;
+    QVERIFY(reader.decodeChunk(0, decoded.times, decoded.pressures, decoded.statuses));
+    QVERIFY(decoded.pressures.last() == samples.pressures.at(199));
+
+    // The samples after the peek are appended to the same chunk
+    QTemporaryFile chunkFile;
+    QVERIFY(writeFile(chunkFile, CompressedLogEncoder::header(QString(), 0, 512) + chunk));
+    QVERIFY(reader.open(chunkFile.fileName()));
+    QCOMPARE(reader.chunkCount(), 1);
+    QCOMPARE(reader.sampleCount(), qint64(300));
+    decoded = Samples();
+    QVERIFY(reader.decodeChunk(0, decoded.times, decoded.pressures, decoded.statuses));
+    for(int i=0; i<300; i++)
+        QVERIFY(decoded.pressures.at(i) == samples.pressures.at(i));
+}
+
+
+QTEST_APPLESS_MAIN(TestCompressedLog)
+
+#include "tst_compressedlog.moc"
@@ -0,0 +1,137 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include <QtTest>
+
+#include "lineframer.h"
+
+#include <cstring>
+
+
+class TestLineFramer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void singleLine();
+    void burst();
+    void partialLine();
+    void emptyRecords();
+    void wrapAround();
+};
+
+
+// Writes the bytes as the serial port would: in contiguous pieces
+static void
+feed(LineFramer& framer, const QByteArray& bytes) {
+    int done = 0;
+    while(done < bytes.size()) {
+        int nContiguous;
+        char* p = framer.writePointer(nContiguous);
+        QVERIFY(nContiguous > 0);
+        const int n = qMin(nContiguous, bytes.size()-done);
+        std::memcpy(p, bytes.constData()+done, size_t(n));
+        framer.commit(n);
+        done += n;
+    }
+}
+
+
+void
+TestLineFramer::singleLine() {
+    LineFramer framer;
+    QVector<QByteArray> lines;
+    QVector<int> bytesAfter;
+    feed(framer, "0,+1.0000E-03\r\n");
+    QCOMPARE(framer.takeLines(lines, bytesAfter), 1);
+    QCOMPARE(lines.at(0), QByteArray("0,+1.0000E-03"));
+    QCOMPARE(bytesAfter.at(0), 0);
+    QCOMPARE(framer.pendingBytes(), 0);
+}
+
+
+void
+TestLineFramer::burst() {
+    LineFramer framer;
+    QVector<QByteArray> lines;
+    QVector<int> bytesAfter;
+    feed(framer, "0,+1.0000E-03\r\n1,+2.0000E-04\r\n2,+3.0000E+02\r\n0,+4");
+    QCOMPARE(framer.takeLines(lines, bytesAfter), 3);
+    QCOMPARE(lines.at(0), QByteArray("0,+1.0000E-03"));
+    QCOMPARE(lines.at(1), QByteArray("1,+2.0000E-04"));
+    QCOMPARE(lines.at(2), QByteArray("2,+3.0000E+02"));
+    QCOMPARE(bytesAfter.at(0), 34);
+    QCOMPARE(bytesAfter.at(1), 19);
+    QCOMPARE(bytesAfter.at(2), 4);
+    QCOMPARE(framer.pendingBytes(), 4);
+}
+
+
+void
+TestLineFramer::partialLine() {
+    LineFramer framer;
+    QVector<QByteArray> lines;
+    QVector<int> bytesAfter;
+    feed(framer, "0,+1.00");
+    QCOMPARE(framer.takeLines(lines, bytesAfter), 0);
+    QCOMPARE(framer.pendingBytes(), 7);
+    feed(framer, "00E-03\r");
+    QCOMPARE(framer.takeLines(lines, bytesAfter), 0);
+    feed(framer, "\n");
+    QCOMPARE(framer.takeLines(lines, bytesAfter), 1);
+    QCOMPARE(lines.at(0), QByteArray("0,+1.0000E-03"));
+}
+
+
+void
+TestLineFramer::emptyRecords() {
+    LineFramer framer;
+    QVector<QByteArray> lines;
+    QVector<int> bytesAfter;
+    feed(framer, "\r\n\n\r\r\n0,+1.0000E-03\n");
+    QCOMPARE(framer.takeLines(lines, bytesAfter), 1);
+    QCOMPARE(lines.at(0), QByteArray("0,+1.0000E-03"));
+}
+
+
+// The records straddling the end of the smallest ring are copied
+void
+TestLineFramer::wrapAround() {
+    LineFramer framer(64);
+    QVector<QByteArray> lines;
+    QVector<int> bytesAfter;
+    for(int i=0; i<100; i++) {
+        QByteArray record = QByteArray::number(i%7) + ",+" + QByteArray::number(i) + ".0000E-03";
+        lines.resize(0);
+        bytesAfter.resize(0);
+        feed(framer, record + "\r\n");
+        QCOMPARE(framer.takeLines(lines, bytesAfter), 1);
+        QCOMPARE(lines.at(0), record);
+        QCOMPARE(framer.pendingBytes(), 0);
+    }
+}
+
+
+QTEST_APPLESS_MAIN(TestLineFramer)
+
+#include "tst_lineframer.moc"
@@ -0,0 +1,266 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+
+#include <QtTest>
+
+#include "pixeltransform.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <random>
+
+
+class TestPixelTransform : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void linearAxis();
+    void logAxis();
+    void limitsMask();
+    void combinedMask();
+    void everyLength();
+    void m4Columns();
+    void m4Excluded();
+    void m4StopsPastFrame();
+};
+
+
+// The scalar mapping of the plot before transformAxis()
+static int
+referencePixel(const AxisTransform& t, double v) {
+    if(t.bLog) {
+        if(!(v > 0.0))
+            return -INT_MAX;
+        return int(t.origin + (std::log10(v) - t.vMin)*t.factor);
+    }
+    return int(t.origin + (v - t.vMin)*t.factor);
+}
+
+
+static quint8
+referenceInside(const AxisTransform& t, double v) {
+    return (v >= t.lo && v <= t.hi) ? 1 : 0;
+}
+
+
+// A 800 x 600 frame, the pixel y growing downwards
+static AxisTransform
+linearTransform() {
+    AxisTransform t;
+    t.lo     = -3.5;
+    t.hi     = 1234.25;
+    t.vMin   = t.lo;
+    t.factor = 800.0/(t.hi-t.lo);
+    t.origin = 40.0;
+    t.bLog   = false;
+    return t;
+}
+
+
+static AxisTransform
+logTransform() {
+    AxisTransform t;
+    t.lo     = 1.0e-9;
+    t.hi     = 1.0e+3;
+    t.vMin   = std::log10(t.lo);
+    t.factor = -600.0/(std::log10(t.hi)-t.vMin);
+    t.origin = 620.0;
+    t.bLog   = true;
+    return t;
+}
+
+
+// Checks n values starting at an odd offset, so that the SIMD loads
+// are not aligned and the scalar tail is used
+static void
+check(const AxisTransform& t, const QVector<double>& values, bool bCombine = false) {
+    const int n = values.count();
+    QVector<double> v(n+1), logV(n+1);
+    for(int i=0; i<n; i++) {
+        v[i+1]    = values.at(i);
+        logV[i+1] = std::log10(values.at(i));
+    }
+    QVector<int> pixels(n+1, 0);
+    QVector<quint8> mask(n+1, 0);
+    for(int i=0; i<n; i++)
+        mask[i+1] = quint8(i % 3 != 0);
+    const QVector<quint8> previous = mask;
+    transformAxis(t, v.constData()+1, logV.constData()+1, n, pixels.data()+1, mask.data()+1, bCombine);
+    for(int i=0; i<n; i++) {
+        const double value = values.at(i);
+        QCOMPARE(pixels.at(i+1), referencePixel(t, value));
+        quint8 inside = referenceInside(t, value);
+        if(bCombine)
+            inside &= previous.at(i+1);
+        QCOMPARE(mask.at(i+1), inside);
+    }
+}
+
+
+void
+TestPixelTransform::linearAxis() {
+    const AxisTransform t = linearTransform();
+    std::mt19937 generator(261);
+    std::uniform_real_distribution<double> distribution(-2000.0, 3000.0);
+    QVector<double> values;
+    for(int i=0; i<100003; i++)
+        values.append(distribution(generator));
+    // Values falling on pixel boundaries, and around the origin
+    for(int p=-50; p<900; p++) {
+        const double v = t.vMin + (p-t.origin)/t.factor;
+        values << v << std::nextafter(v, -HUGE_VAL) << std::nextafter(v, HUGE_VAL);
+    }
+    values << 0.0 << -0.0 << t.lo << t.hi;
+    check(t, values);
+}
+
+
+// The log10 are computed by the caller, as DataStream2D does;
+// not positive coordinates and NaN are excluded
+void
+TestPixelTransform::logAxis() {
+    const AxisTransform t = logTransform();
+    std::mt19937 generator(261);
+    std::uniform_real_distribution<double> exponent(-12.0, 5.0);
+    QVector<double> values;
+    for(int i=0; i<100003; i++)
+        values.append(std::pow(10.0, exponent(generator)));
+    values << 0.0 << -0.0 << -1.0 << -1.0e-300 << 4.9e-324 << std::nan("")
+           << t.lo << t.hi << 1.0 << 10.0 << 1.0e-6;
+    check(t, values);
+    for(int i=0; i<values.count(); i+=1000)
+        values[i] = -values.at(i);
+    check(t, values);
+}
+
+
+void
+TestPixelTransform::limitsMask() {
+    const AxisTransform t = linearTransform();
+    QVector<double> values;
+    values << t.lo << std::nextafter(t.lo, -HUGE_VAL) << std::nextafter(t.lo, HUGE_VAL)
+           << t.hi << std::nextafter(t.hi, -HUGE_VAL) << std::nextafter(t.hi, HUGE_VAL)
+           << -1.0e6 << 1.0e6 << 0.0;
+    check(t, values);
+    QVector<double> v(1, std::nan(""));
+    QVector<int> pixels(1);
+    QVector<quint8> mask(1, 1);
+    transformAxis(logTransform(), v.constData(), v.constData(), 1, pixels.data(), mask.data(), false);
+    QCOMPARE(mask.at(0), quint8(0));
+    QCOMPARE(pixels.at(0), -INT_MAX);
+}
+
+
+// The y axis mask is and-ed with the x one
+void
+TestPixelTransform::combinedMask() {
+    QVector<double> values;
+    for(int i=0; i<1000; i++)
+        values.append(-10.0 + 1.37*i);
+    check(linearTransform(), values, true);
+    check(logTransform(), values, true);
+}
+
+
+// Every remainder of the AVX2 (4) and SSE2 (2) loops
+void
+TestPixelTransform::everyLength() {
+    QVector<double> values;
+    for(int n=0; n<=33; n++) {
+        check(linearTransform(), values);
+        check(logTransform(), values);
+        check(logTransform(), values, true);
+        values.append(n % 5 == 4 ? -double(n) : 0.37*n*n);
+    }
+}
+
+
+// Each column keeps its first, minimum, maximum and last point, in the
+// order of the samples, and nothing else
+void
+TestPixelTransform::m4Columns() {
+    std::mt19937 generator(261);
+    std::uniform_int_distribution<int> distribution(0, 599);
+    QVector<int> x, y;
+    for(int column=0; column<200; column++)
+        for(int k=0; k<1+column%7; k++) {
+            x.append(column);
+            y.append(distribution(generator));
+        }
+    QVector<QPoint> path;
+    reduceM4(x.constData(), y.constData(), x.count(), INT_MAX, path);
+    int iPath = 0;
+    for(int i=0; i<x.count(); ) {
+        int j = i;
+        int iMin = i, iMax = i;
+        for(; j<x.count() && x.at(j) == x.at(i); j++) {
+            if(y.at(j) < y.at(iMin)) iMin = j;
+            if(y.at(j) > y.at(iMax)) iMax = j;
+        }
+        QVector<int> kept;
+        kept << i << iMin << iMax << j-1;
+        std::sort(kept.begin(), kept.end());
+        kept.erase(std::unique(kept.begin(), kept.end()), kept.end());
+        for(int k : kept) {
+            QVERIFY(iPath < path.count());
+            QCOMPARE(path.at(iPath), QPoint(x.at(k), y.at(k)));
+            iPath++;
+        }
+        i = j;
+    }
+    QCOMPARE(iPath, path.count());
+}
+
+
+// An excluded point ends the column and is kept
+void
+TestPixelTransform::m4Excluded() {
+    const int x[] = {5, 5, -INT_MAX, 5, 5, 6};
+    const int y[] = {1, 9, 3, -INT_MAX, 4, 2};
+    QVector<QPoint> path;
+    reduceM4(x, y, 6, INT_MAX, path);
+    QVector<QPoint> expected;
+    expected << QPoint(5, 1) << QPoint(5, 9) << QPoint(-INT_MAX, 3)
+             << QPoint(5, -INT_MAX) << QPoint(5, 4) << QPoint(6, 2);
+    QCOMPARE(path, expected);
+}
+
+
+// The first point past the frame is kept, to draw the segment to it
+void
+TestPixelTransform::m4StopsPastFrame() {
+    const int x[] = {1, 2, 3, 4, 5};
+    const int y[] = {1, 2, 3, 4, 5};
+    QVector<QPoint> path;
+    reduceM4(x, y, 5, 2, path);
+    QCOMPARE(path.count(), 3);
+    QCOMPARE(path.last(), QPoint(3, 3));
+}
+
+
+QTEST_APPLESS_MAIN(TestPixelTransform)
+
+#include "tst_pixeltransform.moc"
@@ -0,0 +1,12 @@
+QT += testlib
+QT -= gui
+
+CONFIG += testcase console c++17
+CONFIG -= app_bundle
+
+TARGET = tst_samplestore
+INCLUDEPATH += ../..
+
+SOURCES += \
+    tst_samplestore.cpp \
+    ../../samplestore.cpp
@@ -0,0 +1,141 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+
+#include <QtTest>
+
+#include "samplestore.h"
+
+
+class TestSampleStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void residentOnly();
+    void loadBack();
+    void leastRecentlyUsed();
+    void clearedMeanwhile();
+};
+
+
+static const int n = SampleStore::pageSamples;
+
+
+// Pages of one sample per second: page i holds [i*n, (i+1)*n)
+static void
+fill(SampleStore& store, int nPages, qint64 budgetPages) {
+    store.setMemoryBudget(budgetPages*2*n*qint64(sizeof(double)));
+    for(int i=0; i<nPages*n; i++)
+        store.append(i, -i);
+}
+
+
+static double
+pageFrom(int page) {
+    return double(page)*n;
+}
+
+
+static double
+pageTo(int page) {
+    return double(page)*n + n-1;
+}
+
+
+static bool
+load(SampleStore& store, double xFrom, double xTo) {
+    QVector<SampleStore::PageLoad> loads = store.pagesToLoad(xFrom, xTo);
+    QString sError;
+    if(!SampleStore::loadPages(store.fileName(), loads, sError))
+        return false;
+    store.install(loads);
+    return true;
+}
+
+
+void
+TestSampleStore::residentOnly() {
+    SampleStore store;
+    fill(store, 6, 2);
+    QCOMPARE(store.count(), qint64(6*n));
+    QCOMPARE(store.residentBytes(), qint64(2*2*n*sizeof(double)));
+    QVector<double> x, y;
+    QVERIFY(store.read(pageFrom(4), pageTo(5), x, y));
+    QCOMPARE(x.count(), 2*n);
+    QVERIFY(!store.read(pageFrom(0), pageTo(0), x, y));
+    QCOMPARE(store.pagesToLoad(pageFrom(0), pageTo(2)).count(), 3);
+    QCOMPARE(store.pagesToLoad(pageFrom(4), pageTo(5)).count(), 0);
+}
+
+
+void
+TestSampleStore::loadBack() {
+    SampleStore store;
+    fill(store, 6, 2);
+    QVERIFY(load(store, pageFrom(1), pageTo(1)));
+    QVector<double> x, y;
+    QVERIFY(store.read(pageFrom(1)+10, pageFrom(1)+19, x, y));
+    QCOMPARE(x.count(), 10);
+    QCOMPARE(x.first(), pageFrom(1)+10);
+    QCOMPARE(y.last(), -(pageFrom(1)+19));
+    QCOMPARE(store.residentBytes(), qint64(2*2*n*sizeof(double)));
+}
+
+
+// The page read last survives the pages completed after it
+void
+TestSampleStore::leastRecentlyUsed() {
+    SampleStore store;
+    fill(store, 4, 2);
+    QVector<double> x, y;
+    QVERIFY(store.read(pageFrom(2), pageTo(2), x, y));
+    for(int i=4*n; i<5*n; i++)
+        store.append(i, -i);
+    QVERIFY(store.read(pageFrom(2), pageTo(2), x, y));
+    QVERIFY(store.read(pageFrom(4), pageTo(4), x, y));
+    QVERIFY(!store.read(pageFrom(3), pageTo(3), x, y));
+}
+
+
+// The pages read back for a store cleared meanwhile are dropped
+void
+TestSampleStore::clearedMeanwhile() {
+    SampleStore store;
+    fill(store, 4, 1);
+    QVector<SampleStore::PageLoad> loads = store.pagesToLoad(pageFrom(0), pageTo(0));
+    QCOMPARE(loads.count(), 1);
+    QString sError;
+    QVERIFY(SampleStore::loadPages(store.fileName(), loads, sError));
+    store.clear();
+    fill(store, 4, 1);
+    store.install(loads);
+    QCOMPARE(store.residentBytes(), qint64(2*n*sizeof(double)));
+    QVector<double> x, y;
+    QVERIFY(!store.read(pageFrom(0), pageTo(0), x, y));
+}
+
+
+QTEST_APPLESS_MAIN(TestSampleStore)
+
+#include "tst_samplestore.moc"
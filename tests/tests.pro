@@ -0,0 +1,12 @@
+# Unit tests (Qt Test): qmake && make && make check
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    lineframer \
+    tpgparser \
+    textrecord \
+    binarylog \
+    compressedlog \
+    textrunparser \
+    samplestore \
+    pixeltransform
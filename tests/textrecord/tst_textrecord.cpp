@@ -0,0 +1,163 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include <QtTest>
+#include <QTemporaryFile>
+
+#include "textrecord.h"
+
+#include <cmath>
+#include <limits>
+
+
+class TestTextRecord : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void encode_data();
+    void encode();
+    void matchesQString_data();
+    void matchesQString();
+    void append();
+    void readBack();
+};
+
+
+static QByteArray
+encoded(double time, double pressure) {
+    char record[TextRecordEncoder::maxRecordLength];
+    return QByteArray(record, TextRecordEncoder::encode(record, time, pressure));
+}
+
+
+void
+TestTextRecord::encode_data() {
+    QTest::addColumn<double>("time");
+    QTest::addColumn<double>("pressure");
+    QTest::addColumn<QByteArray>("record");
+    QTest::newRow("start")   << 0.0       << 1013.25   << QByteArray("        0.000000      1013.25\n");
+    QTest::newRow("100 ms")  << 0.1       << 1.2345e-3 << QByteArray("        0.100000    0.0012345\n");
+    QTest::newRow("1 day")   << 86400.1   << 2.5e-7    << QByteArray("    86400.100000      2.5e-07\n");
+    QTest::newRow("30 h")    << 108000.3  << 1.0e-9    << QByteArray("   108000.300000        1e-09\n");
+    QTest::newRow("1 year")  << 31536000.5 << 1.0e-9   << QByteArray(" 31536000.500000        1e-09\n");
+    QTest::newRow("1e9 s")   << 999999999.25 << 1.0e-9 << QByteArray("999999999.250000        1e-09\n");
+    QTest::newRow("1e15 s")  << 1.0e15    << 1.0       << QByteArray("           1e+15            1\n");
+    QTest::newRow("no time") << std::numeric_limits<double>::quiet_NaN()
+                             << 1.0 << QByteArray("             nan            1\n");
+}
+
+
+// The time keeps six decimals, the pressure six digits
+void
+TestTextRecord::encode() {
+    QFETCH(double, time);
+    QFETCH(double, pressure);
+    QFETCH(QByteArray, record);
+    QCOMPARE(encoded(time, pressure), record);
+}
+
+
+void
+TestTextRecord::matchesQString_data() {
+    QTest::addColumn<double>("time");
+    QTest::addColumn<double>("pressure");
+    QTest::newRow("start")      << 0.0          << 1013.25;
+    QTest::newRow("atmosphere") << 0.1          << 1000.0;
+    QTest::newRow("roughing")   << 12.345678    << 5.0e-2;
+    QTest::newRow("rounding")   << 59.9999996   << 9.999995e-4;
+    QTest::newRow("high vac")   << 3600.000001  << 1.234567e-6;
+    QTest::newRow("1 day")      << 86400.1      << 2.5e-7;
+    QTest::newRow("30 h")       << 108000.3     << 1.0e-9;
+    QTest::newRow("UHV")        << 604800.25    << 3.3e-11;
+    QTest::newRow("1e9 s")      << 999999999.25 << 123456.7;
+    QTest::newRow("negative")   << -0.5         << -1.0e-3;
+}
+
+
+// Both columns are the ones of QString("%1 %2\n")
+//     .arg(time, 16, 'f', 6).arg(pressure, 12, 'g', 6)
+void
+TestTextRecord::matchesQString() {
+    QFETCH(double, time);
+    QFETCH(double, pressure);
+    const QString sExpected = QString("%1 %2\n")
+                              .arg(time, 16, 'f', 6, ' ')
+                              .arg(pressure, 12, 'g', 6, ' ');
+    QCOMPARE(encoded(time, pressure), sExpected.toLatin1());
+}
+
+
+// The buffer grows past its initial 256 records
+void
+TestTextRecord::append() {
+    TextRecordEncoder encoder;
+    QByteArray expected;
+    for(int i=0; i<1000; i++) {
+        encoder.append(i*0.1, 1.0e-3*(i+1));
+        expected += encoded(i*0.1, 1.0e-3*(i+1));
+    }
+    QCOMPARE(encoder.records(), 1000);
+    QCOMPARE(QByteArray(encoder.data(), encoder.size()), expected);
+    encoder.clear();
+    QCOMPARE(encoder.records(), 0);
+    QCOMPARE(encoder.size(), 0);
+}
+
+
+// Times past 1e5 s still read back to the microsecond
+void
+TestTextRecord::readBack() {
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QStringList commentLines;
+    commentLines << "Start: 2021-03-04T05:06:07.890 (Time = 0 s)" << "Sample A";
+    file.write(TextRecordEncoder::header(commentLines));
+    TextRecordEncoder encoder;
+    const int nRecords = 1000;
+    for(int i=0; i<nRecords; i++)
+        encoder.append(100000.0+i*0.1, 1.0e-3*(i+1));
+    file.write(encoder.data(), encoder.size());
+    file.close();
+
+    TextLogReader reader;
+    QVERIFY(reader.open(file.fileName()));
+    double time, pressure;
+    double lastTime = -1.0;
+    for(int i=0; i<nRecords; i++) {
+        QVERIFY(reader.next(time, pressure));
+        QVERIFY(std::fabs(time-(100000.0+i*0.1)) < 1.0e-6);
+        QVERIFY(time > lastTime);
+        QCOMPARE(pressure, 1.0e-3*(i+1));
+        lastTime = time;
+    }
+    QVERIFY(!reader.next(time, pressure));
+    QCOMPARE(reader.infoLines(), commentLines);
+    QCOMPARE(reader.startMsecsSinceEpoch(),
+             QDateTime::fromString("2021-03-04T05:06:07.890", Qt::ISODateWithMs).toMSecsSinceEpoch());
+}
+
+
+QTEST_APPLESS_MAIN(TestTextRecord)
+
+#include "tst_textrecord.moc"
@@ -0,0 +1,12 @@
+QT += testlib
+QT -= gui
+
+CONFIG += testcase console c++17
+CONFIG -= app_bundle
+
+TARGET = tst_textrunparser
+INCLUDEPATH += ../..
+
+SOURCES += \
+    tst_textrunparser.cpp \
+    ../../textrunparser.cpp
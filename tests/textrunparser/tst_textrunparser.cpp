@@ -0,0 +1,111 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+
+#include <QtTest>
+
+#include "textrunparser.h"
+
+
+class TestTextRunParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parse();
+    void split_data();
+    void split();
+};
+
+
+static QVector<TextRunParser::Chunk>
+parseChunks(const QByteArray& text, int nChunks) {
+    QVector<TextRunParser::Chunk> chunks = TextRunParser::split(text.constData(), text.size(), nChunks);
+    for(int i=0; i<chunks.count(); i++)
+        TextRunParser::parse(chunks[i]);
+    return chunks;
+}
+
+
+// Comments, blank and broken lines are skipped; "\r\n" is accepted
+void
+TestTextRunParser::parse() {
+    const QByteArray text("# TPG 261 run\n"
+                          "#\n"
+                          "    0.500000 1.000000e-03\n"
+                          "\n"
+                          "1.5\t2.5e+02\r\n"
+                          "garbage\n"
+                          "2.5 \n"
+                          "  3.250000   -4e-9");
+    QVector<double> x, y;
+    TextRunParser::join(parseChunks(text, 1), x, y);
+    QCOMPARE(x, QVector<double>({0.5, 1.5, 3.25}));
+    QCOMPARE(y, QVector<double>({1.0e-3, 250.0, -4.0e-9}));
+}
+
+
+void
+TestTextRunParser::split_data() {
+    QTest::addColumn<int>("nChunks");
+    QTest::newRow("1")    << 1;
+    QTest::newRow("7")    << 7;
+    QTest::newRow("64")   << 64;
+    QTest::newRow("5000") << 5000;
+}
+
+
+// The chunks end at line boundaries, cover the whole file and
+// give the same points in the same order, however many they are
+void
+TestTextRunParser::split() {
+    QFETCH(int, nChunks);
+    QByteArray text("# Comment line\n");
+    QVector<double> expectedX, expectedY;
+    for(int i=0; i<1000; i++) {
+        expectedX.append(i*0.25);
+        expectedY.append(1.0e-3*(i+1));
+        text += QByteArray::number(expectedX.last(), 'f', 6) + ' ' +
+                QByteArray::number(expectedY.last(), 'e', 6) + '\n';
+    }
+    const QVector<TextRunParser::Chunk> chunks = parseChunks(text, nChunks);
+    QVERIFY(chunks.count() <= nChunks);
+    QVERIFY(chunks.first().pBegin == text.constData());
+    QVERIFY(chunks.last().pEnd == text.constData()+text.size());
+    for(int i=1; i<chunks.count(); i++) {
+        QVERIFY(chunks.at(i).pBegin == chunks.at(i-1).pEnd);
+        QCOMPARE(chunks.at(i).pBegin[-1], '\n');
+    }
+    QVector<double> x, y;
+    TextRunParser::join(chunks, x, y);
+    QCOMPARE(x.count(), expectedX.count());
+    for(int i=0; i<x.count(); i++) {
+        QCOMPARE(x.at(i), expectedX.at(i));
+        QVERIFY(qAbs(y.at(i)-expectedY.at(i)) <= 1.0e-9*expectedY.at(i));
+    }
+}
+
+
+QTEST_APPLESS_MAIN(TestTextRunParser)
+
+#include "tst_textrunparser.moc"
@@ -0,0 +1,118 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include <QtTest>
+
+#include "tpgparser.h"
+
+#include <cstdio>
+#include <cstring>
+
+
+class TestTpgParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void measurement();
+    void statusCodes();
+    void spaces();
+    void secondGauge();
+    void invalid();
+};
+
+
+static bool
+parse(const char* pLine, int& status, double& pressure) {
+    return parseTpgMeasurement(pLine, int(std::strlen(pLine)), status, pressure);
+}
+
+
+void
+TestTpgParser::measurement() {
+    int status = -1;
+    double pressure = 0.0;
+    QVERIFY(parse("0,+1.2345E-03", status, pressure));
+    QCOMPARE(status, 0);
+    QCOMPARE(pressure, 1.2345e-3);
+    QVERIFY(parse("0,+9.9990E+02", status, pressure));
+    QCOMPARE(pressure, 999.9);
+    QVERIFY(parse("0,-1.0000E-09", status, pressure));
+    QCOMPARE(pressure, -1.0e-9);
+}
+
+
+void
+TestTpgParser::statusCodes() {
+    int status = -1;
+    double pressure = 0.0;
+    for(int i=0; i<=6; i++) {
+        char line[16];
+        std::snprintf(line, sizeof(line), "%d,+2.0000E-01", i);
+        QVERIFY(parse(line, status, pressure));
+        QCOMPARE(status, i);
+        QCOMPARE(pressure, 0.2);
+    }
+}
+
+
+void
+TestTpgParser::spaces() {
+    int status = -1;
+    double pressure = 0.0;
+    QVERIFY(parse(" 1, +3.0000E-02 ", status, pressure));
+    QCOMPARE(status, 1);
+    QCOMPARE(pressure, 0.03);
+}
+
+
+// The fields of the second gauge of a TPG 262 are ignored
+void
+TestTpgParser::secondGauge() {
+    int status = -1;
+    double pressure = 0.0;
+    QVERIFY(parse("0,+5.0000E-04,5,+0.0000E+00", status, pressure));
+    QCOMPARE(status, 0);
+    QCOMPARE(pressure, 5.0e-4);
+}
+
+
+// Nothing is changed when the line is rejected
+void
+TestTpgParser::invalid() {
+    const char* lines[] = {"", "0", "0,", "x,+1.0000E-03", "10,+1.0000E-03",
+                           "7,+1.0000E-03", "9,+1.0000E-03",
+                           "0;+1.0000E-03", "0,+1.0000E-03x", "0,abc", "\x06"};
+    for(const char* pLine : lines) {
+        int status = 7;
+        double pressure = 42.0;
+        QVERIFY2(!parse(pLine, status, pressure), pLine);
+        QCOMPARE(status, 7);
+        QCOMPARE(pressure, 42.0);
+    }
+}
+
+
+QTEST_APPLESS_MAIN(TestTpgParser)
+
+#include "tst_tpgparser.moc"
@@ -0,0 +1,211 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include "textrecord.h"
+
+#include <QDateTime>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+
+static const int timeWidth     = 16;
+static const int pressureWidth = 12;
+static const int precision     = 6;
+
+
+// Right-aligns one formatted value in a field of fieldWidth
+// characters (wider values are not truncated, as with QString::arg)
+static char*
+encodeField(char* pOut, double value, int fieldWidth, std::chars_format format) {
+    char  digits[32];
+    char* pEnd;
+    if(std::isnan(value)) {
+        std::memcpy(digits, "nan", 3);
+        pEnd = digits + 3;
+    }
+    else {
+        pEnd = std::to_chars(digits, digits+sizeof(digits), value,
+                             format, precision).ptr;
+    }
+    const int length = int(pEnd - digits);
+    for(int i=length; i<fieldWidth; i++)
+        *pOut++ = ' ';
+    std::memcpy(pOut, digits, size_t(length));
+    return pOut + length;
+}
+
+
+TextRecordEncoder::TextRecordEncoder()
+    : nBytes(0)
+    , nRecords(0)
+{
+    buffer.resize(256*maxRecordLength);
+}
+
+
+int
+TextRecordEncoder::encode(char* pOut, double time, double pressure) {
+    // Beyond 1e15 s (and for inf) the 'f' digits would not fit
+    char* p = encodeField(pOut, time, timeWidth,
+                          std::fabs(time) < 1.0e15 ? std::chars_format::fixed
+                                                   : std::chars_format::general);
+    *p++ = ' ';
+    p = encodeField(p, pressure, pressureWidth, std::chars_format::general);
+    *p++ = '\n';
+    return int(p - pOut);
+}
+
+
+// To cope with the GnuPlot way to handle the comment lines
+// we need a # as a first chraracter in each row.
+QByteArray
+TextRecordEncoder::header(const QStringList& commentLines) {
+    QString sHeader = QString("%1 %2\n")
+                      .arg("#Time[s]", timeWidth)
+                      .arg("Pressure[mbar]", pressureWidth);
+    for(int i=0; i<commentLines.count(); i++) {
+        sHeader += "# ";
+        sHeader += commentLines.at(i);
+        sHeader += "\n";
+    }
+    return sHeader.toLocal8Bit();
+}
+
+
+void
+TextRecordEncoder::append(double time, double pressure) {
+    if(buffer.size()-nBytes < maxRecordLength)
+        buffer.resize(2*buffer.size());
+    nBytes += encode(buffer.data()+nBytes, time, pressure);
+    nRecords++;
+}
+
+
+void
+TextRecordEncoder::clear() {
+    nBytes   = 0;
+    nRecords = 0;
+}
+
+
+const char*
+TextRecordEncoder::data() const {
+    return buffer.constData();
+}
+
+
+int
+TextRecordEncoder::size() const {
+    return nBytes;
+}
+
+
+int
+TextRecordEncoder::records() const {
+    return nRecords;
+}
+
+
+static const char*
+skipSpaces(const char* p, const char* end) {
+    while(p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+
+TextLogReader::TextLogReader()
+    : startMsecs(0)
+    , bRecordsStarted(false)
+{
+}
+
+
+bool
+TextLogReader::open(QString sFileName) {
+    file.setFileName(sFileName);
+    comments.clear();
+    startMsecs      = 0;
+    bRecordsStarted = false;
+    return file.open(QIODevice::ReadOnly|QIODevice::Text);
+}
+
+
+// The "# Start:" line provides the wall clock origin.
+// Lines that can not be parsed are skipped.
+bool
+TextLogReader::next(double& time, double& pressure) {
+    while(!file.atEnd()) {
+        line = file.readLine();
+        const char* end = line.constData() + line.size();
+        while(end > line.constData() && (end[-1] == '\n' || end[-1] == '\r'))
+            end--;
+        const char* p = skipSpaces(line.constData(), end);
+        if(p == end)
+            continue;
+        if(*p == '#') {
+            if(bRecordsStarted || (end-p >= 8 && !std::memcmp(p, "#Time[s]", 8)))
+                continue;
+            QString sComment = QString::fromLocal8Bit(p+1, int(end-p-1));
+            if(sComment.startsWith(' '))
+                sComment.remove(0, 1);
+            if(sComment.startsWith("Start: ")) {
+                QDateTime start = QDateTime::fromString(sComment.mid(7).section(' ', 0, 0),
+                                                        Qt::ISODateWithMs);
+                if(start.isValid())
+                    startMsecs = start.toMSecsSinceEpoch();
+            }
+            comments.append(sComment);
+            continue;
+        }
+        std::from_chars_result result = std::from_chars(p, end, time);
+        if(result.ec != std::errc())
+            continue;
+        p = skipSpaces(result.ptr, end);
+        result = std::from_chars(p, end, pressure);
+        if(result.ec != std::errc())
+            continue;
+        bRecordsStarted = true;
+        return true;
+    }
+    return false;
+}
+
+
+QStringList
+TextLogReader::infoLines() const {
+    return comments;
+}
+
+
+qint64
+TextLogReader::startMsecsSinceEpoch() const {
+    return startMsecs;
+}
+
+
+QString
+TextLogReader::errorString() const {
+    return file.errorString();
+}
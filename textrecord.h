@@ -0,0 +1,77 @@
+// MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QByteArray>
+#include <QStringList>
+#include <QFile>
+
+
+// Allocation free encoder of the gnuplot text records
+//    "%16.6f %12.6g\n"
+// The time [s] keeps its microseconds however long the run is
+// (a 'g' format would lose the fractions of a second after 1e5 s)
+// and stays aligned up to 1e9 s;
+// the pressure is formatted as QString::arg(value, 12, 'g', 6, ' ').
+class TextRecordEncoder
+{
+public:
+    static const int maxRecordLength = 64;
+
+    TextRecordEncoder();
+    void append(double time, double pressure);
+    void clear();
+    const char* data() const;
+    int size() const;
+    int records() const;
+
+    static int encode(char* pOut, double time, double pressure);
+    static QByteArray header(const QStringList& commentLines);
+
+protected:
+    QByteArray buffer;
+    int        nBytes;
+    int        nRecords;
+};
+
+
+// Sequential reader of the gnuplot text files. The comment lines
+// preceding the first record (but the column titles) are returned,
+// without the "# ", by infoLines().
+class TextLogReader
+{
+public:
+    TextLogReader();
+    bool open(QString sFileName);
+    bool next(double& time, double& pressure);
+    QStringList infoLines() const;
+    qint64 startMsecsSinceEpoch() const;
+    QString errorString() const;
+
+protected:
+    QFile       file;
+    QByteArray  line;
+    QStringList comments;
+    qint64      startMsecs;
+    bool        bRecordsStarted;
+};
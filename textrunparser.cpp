@@ -0,0 +1,95 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include "textrunparser.h"
+
+#include <charconv>
+#include <cstring>
+
+
+QVector<TextRunParser::Chunk>
+TextRunParser::split(const char* pData, qint64 size, int nChunks) {
+    QVector<Chunk> chunks;
+    const char* pEnd   = pData + size;
+    const char* pBegin = pData;
+    for(int i=1; i<=nChunks && pBegin<pEnd; i++) {
+        const char* pSplit = pData + size*i/nChunks;
+        if(pSplit < pBegin)
+            pSplit = pBegin;
+        // Each chunk ends after a new line (or at the end of file)
+        const char* pEol = static_cast<const char*>(std::memchr(pSplit, '\n', size_t(pEnd-pSplit)));
+        pSplit = pEol ? pEol+1 : pEnd;
+        Chunk chunk;
+        chunk.pBegin = pBegin;
+        chunk.pEnd   = pSplit;
+        chunks.append(chunk);
+        pBegin = pSplit;
+    }
+    return chunks;
+}
+
+
+// Comment lines ('#') and lines that can not be parsed are skipped
+void
+TextRunParser::parse(Chunk& chunk) {
+    const char* p   = chunk.pBegin;
+    const char* end = chunk.pEnd;
+    chunk.x.reserve(int((end-p)/26));
+    chunk.y.reserve(int((end-p)/26));
+    while(p < end) {
+        const char* pEol = static_cast<const char*>(std::memchr(p, '\n', size_t(end-p)));
+        if(!pEol)
+            pEol = end;
+        while(p < pEol && (*p == ' ' || *p == '\t'))
+            p++;
+        if(p < pEol && *p != '#') {
+            double x, y;
+            std::from_chars_result result = std::from_chars(p, pEol, x);
+            if(result.ec == std::errc()) {
+                p = result.ptr;
+                while(p < pEol && (*p == ' ' || *p == '\t'))
+                    p++;
+                result = std::from_chars(p, pEol, y);
+                if(result.ec == std::errc()) {
+                    chunk.x.append(x);
+                    chunk.y.append(y);
+                }
+            }
+        }
+        p = pEol + 1;
+    }
+}
+
+
+void
+TextRunParser::join(const QVector<Chunk>& chunks, QVector<double>& x, QVector<double>& y) {
+    int nPoints = 0;
+    for(int i=0; i<chunks.count(); i++)
+        nPoints += chunks.at(i).x.count();
+    x.reserve(x.count()+nPoints);
+    y.reserve(y.count()+nPoints);
+    for(int i=0; i<chunks.count(); i++) {
+        x.append(chunks.at(i).x);
+        y.append(chunks.at(i).y);
+    }
+}
@@ -0,0 +1,45 @@
+// MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <QVector>
+
+
+// Parallel parser of the gnuplot text files written during the
+// acquisition: the mapped file is split in chunks at line boundaries,
+// the chunks are parsed independently (e.g. by QtConcurrent::map())
+// and the results joined in file order.
+class TextRunParser
+{
+public:
+    struct Chunk {
+        const char*     pBegin;
+        const char*     pEnd;
+        QVector<double> x;
+        QVector<double> y;
+    };
+
+    static QVector<Chunk> split(const char* pData, qint64 size, int nChunks);
+    static void parse(Chunk& chunk);
+    static void join(const QVector<Chunk>& chunks, QVector<double>& x, QVector<double>& y);
+};
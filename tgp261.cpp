@@ -55,34 +55,290 @@
 #include <QSettings>
 
 #include "tgp261.h"
+#include "tpgparser.h"
 
+
+// The serial port, the line framing and the parsing all live in
+// acquisitionThread. The parsed samples are handed to the GUI thread
+// through sampleRing: the GUI is only told (once) that there are
+// samples to take and drains them at its own pace.
 tgp261::tgp261(QObject *parent)
     : QObject{parent}
     , bInitialized(false)
+    , bNotifyPending(false)
+    , nDropped(0)
+    , bBatching(false)
+    , sPortName(QString("/dev/ttyUSB0"))
+    , baudRate(19200)
+    , negotiatedBaudRate(0)
+    , acquisitionRate(Rate1s)
 {
     pComm = new CommunicationModule();
-    connect(pComm, SIGNAL(newData(QString)),
-            this, SLOT(onNewData(QString)));
+    pComm->moveToThread(&acquisitionThread);
+    connect(&acquisitionThread, SIGNAL(finished()),
+            pComm, SLOT(deleteLater()));
+    // Direct: onNewLines() runs in the acquisition thread
+    connect(pComm, SIGNAL(newLines(QVector<QByteArray>,QVector<qint64>)),
+            this, SLOT(onNewLines(QVector<QByteArray>,QVector<qint64>)),
+            Qt::DirectConnection);
+    connect(pComm, SIGNAL(connectionError(QString,QString)),
+            this, SIGNAL(connectionError(QString,QString)));
+    connect(pComm, SIGNAL(warning(QString)),
+            this, SIGNAL(warning(QString)));
+    acquisitionThread.setObjectName("TGP261 Acquisition");
+    acquisitionThread.start(QThread::TimeCriticalPriority);
+}
+
+
+tgp261::~tgp261() {
+    acquisitionThread.quit();
+    acquisitionThread.wait();
+}
+
+
+// Called in the acquisition thread with all the lines received
+// in a single readyRead(). Must touch nothing but sampleRing and
+// the atomics.
+void
+tgp261::onNewLines(const QVector<QByteArray>& lines, const QVector<qint64>& arrivalNs) {
+    bool bPushed = false;
+    PressureSample sample;
+    for(int i=0; i<lines.count(); i++) {
+        const QByteArray& line = lines.at(i);
+        sample.monotonicNs = arrivalNs.at(i);
+        if(!parseTpgMeasurement(line.constData(), line.size(),
+                                sample.status, sample.pressure))
+            continue;
+        if(!sampleRing.push(sample)) {
+            nDropped++; // The GUI is not keeping up: never wait for it
+            continue;
+        }
+        bPushed = true;
+    }
+    if(bPushed && !bNotifyPending.exchange(true))
+        emit samplesAvailable(); // Queued to the GUI thread
+}
+
+
+// Called in the GUI thread.
+// The notification flag is cleared before popping, so a sample pushed
+// while we are draining will trigger a new samplesAvailable().
+bool
+tgp261::takeSample(PressureSample& sample) {
+    bNotifyPending.store(false);
+    return sampleRing.pop(sample);
+}
+
+
+quint64
+tgp261::droppedSamples() {
+    return nDropped.load();
+}
+
+
+// Asynchronous mnemonic query: sends sMnemonic, waits for the <ACK>,
+// sends <ENQ> and hands the answer to handler (in the GUI thread).
+// Nothing blocks: the handler runs as soon as the gauge answers.
+// Between beginBatch() and endBatch() the query is only collected.
+void
+tgp261::query(QString sMnemonic, ReplyHandler handler, int timeoutMs) {
+    queueRequest(sMnemonic, true, handler, timeoutMs);
+}
+
+
+// A command without answer, like "COM,1"
+void
+tgp261::command(QString sMnemonic) {
+    queueRequest(sMnemonic, false, ReplyHandler(), CommunicationModule::defaultTimeoutMs);
+}
+
+
+void
+tgp261::queueRequest(QString sMnemonic, bool bEnquire, ReplyHandler handler, int timeoutMs) {
+    CommunicationModule::ReplyHandler commHandler;
+    if(handler) {
+        // Called in the acquisition thread: hop back to the GUI thread
+        commHandler = [this, handler](bool bOk, QByteArray reply) {
+            QString sReply = QString::fromLatin1(reply);
+            QMetaObject::invokeMethod(this, [handler, bOk, sReply]() {
+                handler(bOk, sReply);
+            }, Qt::QueuedConnection);
+        };
+    }
+    pendingBatch.append(CommunicationModule::Request(sMnemonic.toLatin1(),
+                                                     bEnquire,
+                                                     commHandler,
+                                                     timeoutMs));
+    if(!bBatching)
+        endBatch();
+}
+
+
+// All the requests issued until endBatch() are sent to the gauge
+// back to back, duplicated reads are collapsed and the continuous
+// transmission of the measurements is resumed only at the end.
+void
+tgp261::beginBatch() {
+    bBatching = true;
+}
+
+
+void
+tgp261::endBatch() {
+    bBatching = false;
+    if(pendingBatch.isEmpty())
+        return;
+    CommunicationModule* pModule = pComm;
+    QList<CommunicationModule::Request> batch = pendingBatch;
+    pendingBatch.clear();
+    QMetaObject::invokeMethod(pComm, [pModule, batch]() {
+        pModule->sendBatch(batch);
+    }, Qt::QueuedConnection);
+}
+
+
+void
+tgp261::setSerialPort(QString sNewPortName, int newBaudRate) {
+    if(sNewPortName == sPortName && newBaudRate == baudRate)
+        return;
+    sPortName = sNewPortName;
+    baudRate  = newBaudRate;
+    bInitialized = false; // A new Init() is needed
 }
 
 
 void
-tgp261::onNewData(QString sData) {
-    QStringList sDataList = QStringList(sData.split(","));
-    if(sDataList.count() > 3)
-        emit dataReady(sDataList.at(1));
+tgp261::setAcquisitionRate(int rate) {
+    acquisitionRate = rate;
+    if(bInitialized)
+        applyAcquisitionRate();
+}
+
+
+int
+tgp261::currentBaudRate() {
+    return negotiatedBaudRate;
 }
 
 
+// Returns false if the serial port cannot be opened.
+// The rest of the initialization (baud rate negotiation, acquisition
+// rate setting) goes on asynchronously and ends with initialized()
+// or with connectionError().
 bool
 tgp261::Init() {
-    if(!pComm->startConnection()) {
+    bInitialized = false;
+    QMetaObject::invokeMethod(pComm, "setPortParameters",
+                              Qt::QueuedConnection,
+                              Q_ARG(QString, sPortName),
+                              Q_ARG(int, baudRate));
+    bool bOk = false;
+    QMetaObject::invokeMethod(pComm, "startConnection",
+                              Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, bOk));
+    if(!bOk) {
         return false;
     }
-    pComm->writeCommand("COM,1"); // Resume Continuous Transmission (if interrupted)
+    negotiateBaudRate(0, true);
+    return true;
+}
+
+
+// Probes the gauge at the wanted baud rate first and then at the other
+// ones it supports. If it answers at a different baud rate it is told
+// (with BAU) to switch to the wanted one and probed again.
+void
+tgp261::negotiateBaudRate(int iCandidate, bool bSwitchAllowed) {
+    const int probeTimeoutMs = 300;
+    QList<int> candidates = {baudRate};
+    const int supported[] = {9600, 19200, 38400};
+    for(int rate : supported) {
+        if(rate != baudRate)
+            candidates.append(rate);
+    }
+    if(iCandidate >= candidates.count()) {
+        emit connectionError(QString("The TPG 261 does not answer at any baud rate"),
+                             sPortName);
+        return;
+    }
+    const int candidate = candidates.at(iCandidate);
+    QMetaObject::invokeMethod(pComm, "setBaudRate",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, candidate));
+    query("TID", [this, iCandidate, candidate, bSwitchAllowed](bool bAnswered, QString sReply) {
+        if(!bAnswered) {
+            negotiateBaudRate(iCandidate+1, bSwitchAllowed);
+            return;
+        }
+        sGaugeId = sReply;
+        int baudCode = -1;
+        if(baudRate == 9600)  baudCode = 0;
+        if(baudRate == 19200) baudCode = 1;
+        if(baudRate == 38400) baudCode = 2;
+        if(candidate == baudRate || !bSwitchAllowed || baudCode < 0) {
+            finishInit(candidate);
+            return;
+        }
+        queueRequest(QString("BAU,%1").arg(baudCode), false,
+                     [this, candidate](bool bAccepted, QString) {
+            if(bAccepted)
+                negotiateBaudRate(0, false);
+            else
+                finishInit(candidate);
+        }, probeTimeoutMs);
+    }, probeTimeoutMs);
+}
+
+
+void
+tgp261::finishInit(int newBaudRate) {
+    negotiatedBaudRate = newBaudRate;
+    beginBatch();
+    query("UNI", [this](bool bAnswered, QString sReply) {
+        if(bAnswered) sUnits = unitsDescription(sReply.toInt());
+    });
+    applyAcquisitionRate();
+    endBatch();
     bInitialized = true;
     emit initialized();
-    return true;
+}
+
+
+void
+tgp261::applyAcquisitionRate() {
+    if(acquisitionRate == RatePolled) {
+        QMetaObject::invokeMethod(pComm, "startPolling",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(QByteArray, QByteArray("PR1")));
+    }
+    else {
+        QMetaObject::invokeMethod(pComm, "stopPolling",
+                                  Qt::QueuedConnection);
+        command(QString("COM,%1").arg(acquisitionRate));
+    }
+}
+
+
+QString
+tgp261::gaugeId() {
+    return sGaugeId;
+}
+
+
+QString
+tgp261::units() {
+    return sUnits;
+}
+
+
+QString
+tgp261::unitsDescription(int units) {
+    switch(units) {
+    case 0:  return QString("mbar");
+    case 1:  return QString("Torr");
+    case 2:  return QString("Pascal");
+    default: return QString("Unknown units %1").arg(units);
+    }
 }
 
 
@@ -92,4 +348,19 @@ tgp261::isInitialized() {
 }
 
 
+QString
+tgp261::statusDescription(int status) {
+    switch(status) {
+    case PressureSample::MeasurementOk:       return QString("Measurement data okay");
+    case PressureSample::Underrange:          return QString("Underrange");
+    case PressureSample::Overrange:           return QString("Overrange");
+    case PressureSample::SensorError:         return QString("Sensor error");
+    case PressureSample::SensorOff:           return QString("Sensor off");
+    case PressureSample::NoSensor:            return QString("No sensor");
+    case PressureSample::IdentificationError: return QString("Identification error");
+    default:                                  return QString("Unknown status %1").arg(status);
+    }
+}
+
+
 
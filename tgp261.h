@@ -24,26 +24,64 @@
 #pragma once
 
 #include <QObject>
+#include <QThread>
+#include <atomic>
+#include <functional>
 
 #include "communicationmodule.h"
+#include "pressuresample.h"
+#include "spscring.h"
 
 class tgp261 : public QObject
 {
     Q_OBJECT
 public:
     explicit tgp261(QObject *parent = nullptr);
+    ~tgp261();
+
+    // Acquisition rates: the first three are the COM,n continuous modes
+    enum AcquisitionRate {
+        Rate100ms = 0,
+        Rate1s    = 1,
+        Rate1min  = 2,
+        RatePolled     // PR1 queried back to back
+    };
+
+    void setSerialPort(QString sNewPortName, int newBaudRate);
+    void setAcquisitionRate(int rate);
+    int  currentBaudRate();
     bool Init();
     bool isInitialized();
+    bool takeSample(PressureSample& sample);
+
+    // Called in the GUI thread when the gauge has answered
+    typedef std::function<void(bool bOk, QString sReply)> ReplyHandler;
+    void query(QString sMnemonic, ReplyHandler handler,
+               int timeoutMs = CommunicationModule::defaultTimeoutMs);
+    void command(QString sMnemonic);
+    void beginBatch();
+    void endBatch();
+    QString gaugeId();
+    QString units();
+    static QString unitsDescription(int units);
+    quint64 droppedSamples();
+    static QString statusDescription(int status);
 
 public slots:
-    void onNewData(QString sData);
+    void onNewLines(const QVector<QByteArray>& lines, const QVector<qint64>& arrivalNs);
 
 signals:
-    void dataReady(QString sData);
+    void samplesAvailable();
     void initialized();
+    void connectionError(QString sError, QString sDevice);
+    void warning(QString sMessage);
 
 protected:
     void Connect();
+    void queueRequest(QString sMnemonic, bool bEnquire, ReplyHandler handler, int timeoutMs);
+    void negotiateBaudRate(int iCandidate, bool bSwitchAllowed);
+    void finishInit(int negotiatedBaudRate);
+    void applyAcquisitionRate();
 
 public:
     CommunicationModule* pComm;// TODO: private !!!
@@ -51,5 +89,17 @@ public:
 protected:
     bool bInitialized;
     QString sResult;
+    QThread acquisitionThread;
+    SpscRing<PressureSample, 4096> sampleRing;
+    std::atomic<bool> bNotifyPending;
+    std::atomic<quint64> nDropped;
+    bool bBatching;
+    QList<CommunicationModule::Request> pendingBatch;
+    QString sGaugeId;
+    QString sUnits;
+    QString sPortName;
+    int baudRate;           // The one we want
+    int negotiatedBaudRate; // The one we got
+    int acquisitionRate;
 };
 
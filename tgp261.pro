@@ -2,8 +2,9 @@ QT += core
 QT += gui
 QT += serialport
 QT += widgets
+QT += concurrent
 
-CONFIG += c++11
+CONFIG += c++17
 
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
@@ -12,25 +13,49 @@ SOURCES += \
     AxisLimits.cpp \
     DataSetProperties.cpp \
     axesdialog.cpp \
+    binarylog.cpp \
     communicationmodule.cpp \
+    compressedlog.cpp \
     datastream2d.cpp \
+    journal.cpp \
+    lineframer.cpp \
     main.cpp \
     mainwindow.cpp \
+    outputwriter.cpp \
+    pixeltransform.cpp \
     plot2d.cpp \
     plotpropertiesdlg.cpp \
-    tgp261.cpp
+    samplestore.cpp \
+    segmentindex.cpp \
+    textrecord.cpp \
+    textrunparser.cpp \
+    tgp261.cpp \
+    tpgparser.cpp
 
 HEADERS += \
     AxisFrame.h \
     AxisLimits.h \
     DataSetProperties.h \
     axesdialog.h \
+    binarylog.h \
     communicationmodule.h \
+    compressedlog.h \
     datastream2d.h \
+    journal.h \
+    lineframer.h \
     mainwindow.h \
+    outputwriter.h \
+    pixeltransform.h \
     plot2d.h \
     plotpropertiesdlg.h \
-    tgp261.h
+    pressuresample.h \
+    samplestore.h \
+    segmentindex.h \
+    spscring.h \
+    textrecord.h \
+    textrunparser.h \
+    tgp261.h \
+    tpgparser.h
 
 FORMS += \
     mainwindow.ui
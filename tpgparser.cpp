@@ -0,0 +1,54 @@
+/* MIT License
+
+// Copyright (c) 2021 Gabriele Salvato
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+*/
+
+#include "tpgparser.h"
+#include "pressuresample.h"
+
+#include <charconv>
+
+
+bool
+parseTpgMeasurement(const char* pLine, int length, int& status, double& pressure) {
+    const char* p   = pLine;
+    const char* end = pLine + length;
+    while(p < end && *p == ' ') p++;
+    // Status: a single digit followed by a comma. The TPG 261
+    // codes end at 6: the binary and compressed logs keep 3 bits.
+    if(end-p < 3 || *p < '0' || *p > '0'+PressureSample::IdentificationError || p[1] != ',')
+        return false;
+    const int iStatus = *p - '0';
+    p += 2;
+    while(p < end && *p == ' ') p++;
+    // std::from_chars() does not accept an explicit '+'
+    if(p < end && *p == '+') p++;
+    const char* pFieldEnd = p;
+    while(pFieldEnd < end && *pFieldEnd != ',') pFieldEnd++;
+    while(pFieldEnd > p && pFieldEnd[-1] == ' ') pFieldEnd--;
+    double value;
+    std::from_chars_result result = std::from_chars(p, pFieldEnd, value);
+    if(result.ec != std::errc() || result.ptr != pFieldEnd)
+        return false;
+    status   = iStatus;
+    pressure = value;
+    return true;
+}